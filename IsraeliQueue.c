@@ -1,26 +1,176 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include "IsraeliQueue.h"
 #include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 #include <math.h>
 #include <assert.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+
+#define NODE_POOL_FIRST_SLAB 16
+#define NODE_POOL_MAX_SLAB 4096
+#define ARRAY_MIN_CAPACITY 16
+#define PAIR_CACHE_FIRST_CAPACITY 1024
+#define PAIR_CACHE_MAX_CAPACITY (1 << 20)
+#define MEASURE_REORDER_INTERVAL 1024
+#define MEASURE_TIMING_PERIOD 32
+#define INGEST_CACHE_LINE 64
 
 typedef struct Node_t* Node;
+typedef struct NodeSlab_t* NodeSlab;
 
 struct Node_t {
     void* m_data;
     int m_friendsCalledOver;
     int m_rivalsBlocked;
     Node m_next;
+    // Links in the queue's active index - the nodes that still have friend or
+    // rival quota left, in queue order. Only valid while the node is active.
+    Node m_activePrev;
+    Node m_activeNext;
+};
+
+// A block of nodes allocated at once by a node pool.
+struct NodeSlab_t {
+    NodeSlab m_next;
+    int m_capacity;
+    struct Node_t m_nodes[];
+};
+
+struct IsraeliQueueNodePool_t {
+    NodeSlab m_slabs;
+    int m_slabUsed;
+    Node m_free;
+    int m_references;
+};
+
+typedef struct PairCacheEntry {
+    void* m_first;
+    void* m_second;
+    int m_status;
+    bool m_used;
+} PairCacheEntry;
+
+// An open addressing hash table from pairs of items to their friendship status.
+// The entries are only valid for the friendship functions and thresholds
+// they were computed with, which the cache keeps a copy of.
+struct IsraeliQueuePairCache_t {
+    PairCacheEntry* m_entries;
+    int m_capacity;
+    int m_count;
+    FriendshipFunction* m_friendships;
+    int m_friendshipsLength;
+    int m_friendshipThreshold;
+    int m_rivalryThreshold;
+    long long m_hits;
+    long long m_misses;
+    int m_references;
+};
+
+// What a queue knows about one of its friendship functions, for calling them
+// in a different order than they were added in.
+typedef struct MeasureInfo {
+    int m_lowerBound;
+    bool m_bounded;
+    long long m_calls;
+    long long m_exits;
+    long long m_timedCalls;
+    long long m_timedNanoseconds;
+} MeasureInfo;
+
+// An enqueue or dequeue of a concurrent queue, published by the thread that
+// called it for whichever thread holds the queue's lock to carry out.
+typedef struct CombiningRequest {
+    bool m_dequeue;
+    void* m_data;
+    IsraeliQueueError m_error;
+    int m_done;
+    struct CombiningRequest* m_next;
+} CombiningRequest;
+
+// The synchronization of a queue created by IsraeliQueueCreateConcurrent.
+// Requests are pushed onto m_published without locking, and the thread that
+// gets the lock carries out all of them in the order they were published
+// (flat combining). m_size follows the queue's size for lock-free reads.
+typedef struct Combiner {
+    pthread_mutex_t m_lock;
+    CombiningRequest* m_published;
+    int m_size;
+} Combiner;
+
+// A slot of an ingest buffer. m_sequence tells whose turn it is: it equals the
+// position of the next push into the slot while the slot is free, and that
+// position plus one once the pushed item can be drained.
+typedef struct IngestCell {
+    size_t m_sequence;
+    void* m_data;
+} IngestCell;
+
+// A bounded multi-producer single-consumer ring buffer. Producers take
+// positions from m_tail with compare-and-swap, and the consumer alone moves
+// m_head. The two are kept on separate cache lines so that pushing does not
+// slow down draining.
+struct IsraeliQueueIngestBuffer_t {
+    IsraeliQueue m_queue;
+    IngestCell* m_cells;
+    size_t m_mask;
+    void** m_batch;
+    char m_tailPadding[INGEST_CACHE_LINE];
+    size_t m_tail;
+    char m_headPadding[INGEST_CACHE_LINE];
+    size_t m_head;
 };
 
 struct IsraeliQueue_t {
+    IsraeliQueueBackend m_backend;
+    int m_size;
+
+    // Linked list backend.
+    IsraeliQueueNodePool m_pool;
     Node m_list;
+    Node m_tail;
+    Node m_activeHead;
+    Node m_activeTail;
+
+    // Array backend. The items and their counters are kept in parallel arrays,
+    // laid out as [m_head, m_gapStart) followed by [m_gapEnd, m_capacity).
+    void** m_items;
+    int* m_itemsFriendsCalledOver;
+    int* m_itemsRivalsBlocked;
+    int m_capacity;
+    int m_head;
+    int m_gapStart;
+    int m_gapEnd;
+    // Counts the queues sharing the arrays after IsraeliQueueSnapshot, or is
+    // NULL while the queue owns them alone.
+    int* m_arraysReferences;
+
     FriendshipFunction* m_friendships;
     int m_friendshipsLength;
+    FriendshipScorer m_scorer;
+
+    // Measure ordering. The arrays are indexed like m_friendships, and are
+    // only allocated once an order or a lower bound is set.
+    IsraeliQueueMeasureOrder m_measureOrder;
+    MeasureInfo* m_measures;
+    int* m_measureSequence;
+    int* m_measureValues;
+    int m_measuresLength;
+    int m_measuresScored;
+    // The sum of the lower bounds, and the number of measures without one.
+    long long m_measuresLowerBounds;
+    int m_measuresUnbounded;
+
     ComparisonFunction m_compare;
     int m_friendshipThreshold;
     int m_rivalryThreshold;
+    IsraeliQueuePairCache m_pairCache;
+    Combiner* m_combiner;
 };
 
 typedef enum FriendStatus {
@@ -60,7 +210,150 @@ int sizeOfFriendshipArray(FriendshipFunction* arr) {
     return size;
 }
 
-FriendStatus getFriendshipStatus(IsraeliQueue q, void* data1, void* data2) {
+// === Measure Ordering Functions ===
+
+// Make room for information about the given number of friendship functions.
+// New functions have no lower bound and are called last.
+bool MeasuresResize(IsraeliQueue q, int length) {
+    int capacity = length > 0 ? length : 1;
+
+    MeasureInfo* measures = (MeasureInfo*)realloc(q->m_measures, sizeof(MeasureInfo) * capacity);
+    if (!measures) {
+        return false;
+    }
+    q->m_measures = measures;
+
+    int* sequence = (int*)realloc(q->m_measureSequence, sizeof(int) * capacity);
+    if (!sequence) {
+        return false;
+    }
+    q->m_measureSequence = sequence;
+
+    int* values = (int*)realloc(q->m_measureValues, sizeof(int) * capacity);
+    if (!values) {
+        return false;
+    }
+    q->m_measureValues = values;
+
+    for (int i = q->m_measuresLength; i < length; i++) {
+        MeasureInfo info = { 0 };
+        q->m_measures[i] = info;
+        q->m_measureSequence[i] = i;
+        q->m_measuresUnbounded++;
+    }
+    q->m_measuresLength = length;
+    return true;
+}
+
+// The key the measures are sorted by, lowest first, in the queue's order.
+double MeasureOrderKey(IsraeliQueue q, int index) {
+    MeasureInfo* info = &q->m_measures[index];
+    if (q->m_measureOrder == ISRAELIQUEUE_ORDER_COST) {
+        return info->m_timedCalls ? (double)info->m_timedNanoseconds / info->m_timedCalls : 0;
+    }
+    if (q->m_measureOrder == ISRAELIQUEUE_ORDER_DECISIVE) {
+        return info->m_calls ? -(double)info->m_exits / info->m_calls : 0;
+    }
+    return index;
+}
+
+// Sort the measure sequence by the queue's order. There are only a few
+// measures, so this is an insertion sort.
+void MeasuresReorder(IsraeliQueue q) {
+    for (int i = 1; i < q->m_measuresLength; i++) {
+        int index = q->m_measureSequence[i];
+        double key = MeasureOrderKey(q, index);
+        int j = i;
+        while (j > 0 && MeasureOrderKey(q, q->m_measureSequence[j - 1]) > key) {
+            q->m_measureSequence[j] = q->m_measureSequence[j - 1];
+            j--;
+        }
+        q->m_measureSequence[j] = index;
+    }
+}
+
+long long MeasureClock(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+// Call one friendship function, timing a sample of the calls.
+int MeasureCall(IsraeliQueue q, int index, void* data1, void* data2) {
+    MeasureInfo* info = &q->m_measures[index];
+    if (info->m_calls++ % MEASURE_TIMING_PERIOD != 0) {
+        return q->m_friendships[index](data1, data2);
+    }
+
+    long long start = MeasureClock();
+    int value = q->m_friendships[index](data1, data2);
+    info->m_timedNanoseconds += MeasureClock() - start;
+    info->m_timedCalls++;
+    return value;
+}
+
+// Call the friendship functions in the queue's measure order to get the status
+// of a pair. In the order they were added, a pair are friends if the sum of
+// some of the first functions exceeds the threshold. The sum of all of them is
+// one of those, so the pair is decided early here once the sum so far, with the
+// lower bounds of the functions left, exceeds the threshold. Otherwise all the
+// functions are called, and their values are summed in the order they were
+// added, deciding exactly like computeFriendshipStatus.
+FriendStatus computeOrderedFriendshipStatus(IsraeliQueue q, void* data1, void* data2) {
+    if (++q->m_measuresScored >= MEASURE_REORDER_INTERVAL) {
+        MeasuresReorder(q);
+        q->m_measuresScored = 0;
+    }
+
+    long long sum = 0;
+    long long boundsLeft = q->m_measuresLowerBounds;
+    int unboundedLeft = q->m_measuresUnbounded;
+
+    for (int k = 0; k < q->m_friendshipsLength; k++) {
+        int index = q->m_measureSequence[k];
+        MeasureInfo* info = &q->m_measures[index];
+        int value = MeasureCall(q, index, data1, data2);
+        q->m_measureValues[index] = value;
+        sum += value;
+
+        if (info->m_bounded) {
+            boundsLeft -= info->m_lowerBound;
+        } else {
+            unboundedLeft--;
+        }
+        if (unboundedLeft == 0 && sum + boundsLeft > q->m_friendshipThreshold) {
+            info->m_exits++;
+            return FRIEND;
+        }
+    }
+
+    int friendshipSum = 0;
+    for (int i = 0; i < q->m_friendshipsLength; i++) {
+        friendshipSum += q->m_measureValues[i];
+        if (friendshipSum > q->m_friendshipThreshold) {
+            return FRIEND;
+        }
+    }
+
+    float friendshipAverage = ((float)friendshipSum) / q->m_friendshipsLength;
+    if (friendshipAverage < q->m_rivalryThreshold) {
+        return RIVAL;
+    }
+
+    return NEUTRAL;
+}
+
+// Call the friendship functions of the queue to get the status of a pair.
+FriendStatus computeFriendshipStatus(IsraeliQueue q, void* data1, void* data2) {
+    // A scorer decides for all the functions at once.
+    if (q->m_scorer) {
+        int score = q->m_scorer(data1, data2, q->m_friendshipThreshold, q->m_rivalryThreshold);
+        return score > 0 ? FRIEND : score < 0 ? RIVAL : NEUTRAL;
+    }
+    if (q->m_measureOrder != ISRAELIQUEUE_ORDER_REGISTRATION) {
+        return computeOrderedFriendshipStatus(q, data1, data2);
+    }
+
     // Iterate over the friendship functions and sum their results.
     // Exit early if one of the functions returns a value that is friendly enough.
     int friendshipSum = 0;
@@ -83,254 +376,1648 @@ FriendStatus getFriendshipStatus(IsraeliQueue q, void* data1, void* data2) {
     return NEUTRAL;
 }
 
+// === Pair Cache Functions ===
 
-// === Node Functions ===
+// Drop one reference to the cache, freeing it with the last one.
+void PairCacheRelease(IsraeliQueuePairCache cache) {
+    if (!cache || --cache->m_references > 0) {
+        return;
+    }
 
-// Initialize a new node in place.
-void NodeInit(Node node, void* data, Node next) {
-    node->m_data = data;
-    node->m_friendsCalledOver = 0;
-    node->m_rivalsBlocked = 0;
-    node->m_next = next;
+    free(cache->m_entries);
+    free(cache->m_friendships);
+    free(cache);
 }
 
-// Create a new node and malloc it.
-Node NodeCreate(void* data, Node next) {
-    Node ret = (Node)malloc(sizeof(struct Node_t));
-    NodeInit(ret, data, next);
-    return ret;
+// Forget all the statuses in the cache.
+void PairCacheClear(IsraeliQueuePairCache cache) {
+    if (cache->m_entries) {
+        memset(cache->m_entries, 0, sizeof(PairCacheEntry) * cache->m_capacity);
+    }
+    cache->m_count = 0;
 }
 
-
-// Returns the first none-blocked friend. If all friends are blocked, returns
-// the first rival that is blocking. If no friends were found, returns the last
-// node in the list.
-// According to those cases, sets the outStatus to the appropriate value.
-Node* findFriendNotBlocked(IsraeliQueue q, void* data, Node stop, FriendStatus* outStatus) {
-    // Iterativly, find the first friend, and if it is blocked, start over.
-    Node* friend = NULL;
-    Node* rival = NULL;
-    Node* last = &q->m_list;
-    for (Node* curr = &q->m_list; *curr != NULL && *curr != stop; curr = &(*curr)->m_next) {
-        // According to the friendship status, update the friend and rival.
-        FriendStatus status = getFriendshipStatus(q, data, (*curr)->m_data);
-        // TODO: Allow a friend that is full but contains the data to be returned.
-        if (status == FRIEND && (*curr)->m_friendsCalledOver < FRIEND_QUOTA && !friend) {
-            friend = curr;
-        } else if (status == RIVAL && (*curr)->m_rivalsBlocked < RIVAL_QUOTA && friend) {
-            friend = NULL;
-            rival = curr;
-        }
-        // Update the last node.
-        last = curr;
+// Make sure the cache holds statuses computed the way the queue computes them,
+// and empty it otherwise. Called before every scan.
+void PairCacheSync(IsraeliQueue q) {
+    IsraeliQueuePairCache cache = q->m_pairCache;
+    if (cache->m_friendships
+        && cache->m_friendshipsLength == q->m_friendshipsLength
+        && cache->m_friendshipThreshold == q->m_friendshipThreshold
+        && cache->m_rivalryThreshold == q->m_rivalryThreshold
+        && memcmp(cache->m_friendships, q->m_friendships, sizeof(FriendshipFunction) * q->m_friendshipsLength) == 0) {
+        return;
     }
 
-    *outStatus = friend ? FRIEND : rival ? RIVAL : NEUTRAL;
-    return friend ? friend : rival ? rival : last;
+    PairCacheClear(cache);
+    free(cache->m_friendships);
+
+    // If the copy fails, the cache stays empty and unused until the next sync.
+    cache->m_friendships = copyToMalloc(q->m_friendships, sizeof(FriendshipFunction) * (q->m_friendshipsLength + 1));
+    cache->m_friendshipsLength = q->m_friendshipsLength;
+    cache->m_friendshipThreshold = q->m_friendshipThreshold;
+    cache->m_rivalryThreshold = q->m_rivalryThreshold;
 }
 
-// Insert a node after the given node. Updates the friends and rivals
-// lists of insertAfter according to the given friendship status.
-void NodeInsertAfter(Node* insertAfter, Node* toInsertPtr, FriendStatus status) {
-    assert(insertAfter);
-    assert(toInsertPtr);
-    assert((*toInsertPtr)->m_next);
+// The slot a pair starts probing from.
+int PairCacheSlot(IsraeliQueuePairCache cache, void* first, void* second) {
+    uint64_t hash = (uint64_t)(uintptr_t)first ^ ((uint64_t)(uintptr_t)second * 0xC2B2AE3D27D4EB4FULL);
+    hash ^= hash >> 32;
+    hash *= 0x9E3779B97F4A7C15ULL;
+    hash ^= hash >> 32;
+    return (int)(hash & (uint64_t)(cache->m_capacity - 1));
+}
 
-    if (*insertAfter == NULL) {
-        *insertAfter = *toInsertPtr;
-        return;
+// Find the entry of the pair, or the empty entry it would go in.
+PairCacheEntry* PairCacheFind(IsraeliQueuePairCache cache, void* first, void* second) {
+    int slot = PairCacheSlot(cache, first, second);
+    while (cache->m_entries[slot].m_used
+           && (cache->m_entries[slot].m_first != first || cache->m_entries[slot].m_second != second)) {
+        slot = (slot + 1) & (cache->m_capacity - 1);
     }
+    return &cache->m_entries[slot];
+}
 
-    /* TODO:
-    // Regular linked list insertion.
-    Node oldNext = (*toInsertPtr)->m_next;
-    (*toInsertPtr)->m_next = (*insertAfter)->m_next;
-    (*insertAfter)->m_next = *toInsertPtr;
-    *toInsertPtr = oldNext;
-    */
-    (*toInsertPtr)->m_next = (*insertAfter)->m_next;
-    (*insertAfter)->m_next = *toInsertPtr;
-    
-    // Update the friends and rivals counters.
-    if (status == FRIEND) {
-        (*insertAfter)->m_friendsCalledOver++;
-    } else if (status == RIVAL) {
-        (*insertAfter)->m_rivalsBlocked++;
+// Double the table, or empty it once it reached its maximal size.
+// Returns false if there is no room for more entries.
+bool PairCacheMakeRoom(IsraeliQueuePairCache cache) {
+    if (cache->m_capacity >= PAIR_CACHE_MAX_CAPACITY) {
+        PairCacheClear(cache);
+        return true;
     }
-}
 
+    PairCacheEntry* old = cache->m_entries;
+    int oldCapacity = cache->m_capacity;
+    int capacity = oldCapacity ? oldCapacity * 2 : PAIR_CACHE_FIRST_CAPACITY;
+    PairCacheEntry* entries = calloc(capacity, sizeof(PairCacheEntry));
+    if (!entries) {
+        return false;
+    }
 
-// === Implementation ===
+    cache->m_entries = entries;
+    cache->m_capacity = capacity;
+    for (int i = 0; i < oldCapacity; i++) {
+        if (old[i].m_used) {
+            *PairCacheFind(cache, old[i].m_first, old[i].m_second) = old[i];
+        }
+    }
+    free(old);
+    return true;
+}
 
-IsraeliQueue IsraeliQueueCreate(FriendshipFunction* friendships, ComparisonFunction compare, int friendshipThreshold, int rivalryThreshold) {
-    IsraeliQueue ret = (IsraeliQueue)malloc(sizeof(struct IsraeliQueue_t));
+// Returns the friendship status between the two items, from the queue's pair
+// cache if it has one.
+FriendStatus getFriendshipStatus(IsraeliQueue q, void* data1, void* data2) {
+    IsraeliQueuePairCache cache = q->m_pairCache;
+    if (!cache || !cache->m_friendships) {
+        return computeFriendshipStatus(q, data1, data2);
+    }
 
-    // Return early if malloc failed.
-    if (!ret) {
-        return NULL;
+    if (cache->m_entries) {
+        PairCacheEntry* entry = PairCacheFind(cache, data1, data2);
+        if (entry->m_used) {
+            cache->m_hits++;
+            return (FriendStatus)entry->m_status;
+        }
     }
 
-    // Copy the friendship functions.
-    int functions = sizeOfFriendshipArray(friendships);
-    FriendshipFunction* friendshipsCopied = (FriendshipFunction*)copyToMalloc(friendships, sizeof(FriendshipFunction) * (functions + 1));
+    cache->m_misses++;
+    FriendStatus status = computeFriendshipStatus(q, data1, data2);
 
-    ret->m_list = NULL;
-    ret->m_friendships = friendshipsCopied;
-    ret->m_friendshipsLength = functions;
-    ret->m_compare = compare;
-    ret->m_friendshipThreshold = friendshipThreshold;
-    ret->m_rivalryThreshold = rivalryThreshold;
-    return ret;
+    // Keep the table at most half full.
+    if ((cache->m_count + 1) * 2 > cache->m_capacity && !PairCacheMakeRoom(cache)) {
+        return status;
+    }
+    PairCacheEntry* entry = PairCacheFind(cache, data1, data2);
+    entry->m_first = data1;
+    entry->m_second = data2;
+    entry->m_status = status;
+    entry->m_used = true;
+    cache->m_count++;
+    return status;
 }
 
-IsraeliQueue IsraeliQueueClone(IsraeliQueue q) {
-    IsraeliQueue out = IsraeliQueueCreate(q->m_friendships, q->m_compare, q->m_friendshipThreshold, q->m_rivalryThreshold);
-    // Clone over the data.
-    Node* outNode = &out->m_list;
-    for (Node inNode = q->m_list; inNode != NULL; inNode = inNode->m_next) {
-        *outNode = NodeCreate(inNode->m_data, NULL);
-        (*outNode)->m_friendsCalledOver = inNode->m_friendsCalledOver;
-        (*outNode)->m_rivalsBlocked = inNode->m_rivalsBlocked;
-        outNode = &(*outNode)->m_next;
+// One step of the placement scan, over an element with the given counters.
+// Returns FRIEND if the element becomes the friend candidate, RIVAL if it
+// blocks the current candidate, and NEUTRAL if it does not change the result.
+// The friendship functions are only called when the element can matter.
+FriendStatus scanElement(IsraeliQueue q, void* data, void* element, int friendsCalledOver,
+                         int rivalsBlocked, bool haveFriend)
+{
+    // A friend only matters while there is no candidate, and a rival only
+    // matters when it can block the current candidate.
+    bool canBeFriend = !haveFriend && friendsCalledOver < FRIEND_QUOTA;
+    bool canBeRival = haveFriend && rivalsBlocked < RIVAL_QUOTA;
+    if (!canBeFriend && !canBeRival) {
+        return NEUTRAL;
     }
-    return out;
+
+    FriendStatus status = getFriendshipStatus(q, data, element);
+    if ((status == FRIEND && canBeFriend) || (status == RIVAL && canBeRival)) {
+        return status;
+    }
+    return NEUTRAL;
 }
 
-void NodeDestroy(Node n) {
-    if (!n) {
+
+
+// === Node Pool Functions ===
+
+// Drop one reference to the pool, freeing all of its slabs with the last one.
+void NodePoolRelease(IsraeliQueueNodePool pool) {
+    if (!pool || --pool->m_references > 0) {
         return;
     }
 
-    NodeDestroy(n->m_next);
-    free(n);
+    while (pool->m_slabs) {
+        NodeSlab next = pool->m_slabs->m_next;
+        free(pool->m_slabs);
+        pool->m_slabs = next;
+    }
+    free(pool);
 }
 
-void IsraeliQueueDestroy(IsraeliQueue q) {
-    // Exit early if the queue is already NULL.
-    if (!q) {
-        return;
+// Take a node from the free list, or from the newest slab if the free list is
+// empty. Allocates a new slab, twice as big as the last one, when it is full.
+Node NodePoolAlloc(IsraeliQueueNodePool pool) {
+    if (pool->m_free) {
+        Node node = pool->m_free;
+        pool->m_free = node->m_next;
+        return node;
     }
 
-    NodeDestroy(q->m_list);
+    if (!pool->m_slabs || pool->m_slabUsed == pool->m_slabs->m_capacity) {
+        int capacity = pool->m_slabs ? pool->m_slabs->m_capacity * 2 : NODE_POOL_FIRST_SLAB;
+        if (capacity > NODE_POOL_MAX_SLAB) {
+            capacity = NODE_POOL_MAX_SLAB;
+        }
 
-    free(q->m_friendships);
-    free(q);
+        NodeSlab slab = malloc(sizeof(struct NodeSlab_t) + sizeof(struct Node_t) * capacity);
+        if (!slab) {
+            return NULL;
+        }
+        slab->m_next = pool->m_slabs;
+        slab->m_capacity = capacity;
+        pool->m_slabs = slab;
+        pool->m_slabUsed = 0;
+    }
+
+    return &pool->m_slabs->m_nodes[pool->m_slabUsed++];
 }
 
-IsraeliQueueError IsraeliQueueEnqueue(IsraeliQueue q, void* data) {
-    FriendStatus status = 0;
-    Node* insertAfter = findFriendNotBlocked(q, data, NULL, &status);
+// Return a node to the pool's free list.
+void NodePoolFree(IsraeliQueueNodePool pool, Node node) {
+    node->m_next = pool->m_free;
+    pool->m_free = node;
+}
 
-    Node toInsert = NodeCreate(data, NULL);
-    if (!toInsert) {
-        return ISRAELIQUEUE_ALLOC_FAILED;
-    }
+// Return a whole list of nodes, from first to last, to the pool's free list.
+void NodePoolFreeList(IsraeliQueueNodePool pool, Node first, Node last) {
+    last->m_next = pool->m_free;
+    pool->m_free = first;
+}
 
-    NodeInsertAfter(insertAfter, &toInsert, status);
-    return ISRAELIQUEUE_SUCCESS;
+
+// === Node Functions ===
+
+// Initialize a new node in place.
+void NodeInit(Node node, void* data, Node next) {
+    node->m_data = data;
+    node->m_friendsCalledOver = 0;
+    node->m_rivalsBlocked = 0;
+    node->m_next = next;
+    node->m_activePrev = NULL;
+    node->m_activeNext = NULL;
 }
 
-IsraeliQueueError IsraeliQueueAddFriendshipMeasure(IsraeliQueue q, FriendshipFunction function) {
-    FriendshipFunction* friendships = (FriendshipFunction*)copyToMallocResize(
-        q->m_friendships,
-        (q->m_friendshipsLength + 1) * sizeof(FriendshipFunction),
-        (q->m_friendshipsLength + 2) * sizeof(FriendshipFunction)
-    );
-    
-    if (!friendships) {
-        return ISRAELIQUEUE_ALLOC_FAILED;
+// Create a new node from the queue's pool. The queue gets a private pool the
+// first time it needs one.
+Node NodeCreate(IsraeliQueue q, void* data, Node next) {
+    if (!q->m_pool) {
+        q->m_pool = IsraeliQueueNodePoolCreate();
+        if (!q->m_pool) {
+            return NULL;
+        }
     }
 
-    friendships[q->m_friendshipsLength] = function;
-    friendships[q->m_friendshipsLength + 1] = NULL;
+    Node ret = NodePoolAlloc(q->m_pool);
+    if (!ret) {
+        return NULL;
+    }
 
-    free(q->m_friendships);
-    q->m_friendships = friendships;
-    q->m_friendshipsLength++;
+    NodeInit(ret, data, next);
+    return ret;
+}
 
-    return ISRAELIQUEUE_SUCCESS;
+// Whether the node can still let a friend in front of it or block a rival.
+// Nodes that can do neither never affect where an item is placed.
+bool NodeIsActive(Node node) {
+    return node->m_friendsCalledOver < FRIEND_QUOTA || node->m_rivalsBlocked < RIVAL_QUOTA;
 }
 
-IsraeliQueueError IsraeliQueueUpdateFriendshipThreshold(IsraeliQueue q, int friendshipThreshold) {
-    if (friendshipThreshold < 0) {
-        return ISRAELIQUEUE_BAD_PARAM;
-    }
 
-    q->m_friendshipThreshold = friendshipThreshold;
-    return ISRAELIQUEUE_SUCCESS;
-}
+// === Active Index Functions ===
 
-IsraeliQueueError IsraeliQueueUpdateRivalryThreshold(IsraeliQueue q, int rivalryThreshold) {
-    if (rivalryThreshold < 0) {
-        return ISRAELIQUEUE_BAD_PARAM;
+// Link an active node into the active index right after the given active
+// node. If after is NULL, the node is linked at the end of the index.
+void ActiveIndexInsertAfter(IsraeliQueue q, Node after, Node node) {
+    Node next = after ? after->m_activeNext : NULL;
+    node->m_activePrev = after ? after : q->m_activeTail;
+    node->m_activeNext = next;
+
+    if (node->m_activePrev) {
+        node->m_activePrev->m_activeNext = node;
+    } else {
+        q->m_activeHead = node;
     }
 
-    q->m_rivalryThreshold = rivalryThreshold;
-    return ISRAELIQUEUE_SUCCESS;
+    if (next) {
+        next->m_activePrev = node;
+    } else {
+        q->m_activeTail = node;
+    }
 }
 
-/**Returns the number of elements of the given queue. If the parameter is NULL, 0
- * is returned.*/
-int IsraeliQueueSize(IsraeliQueue q) {
-    if (!q) {
-        return 0;
+// Unlink a node from the active index.
+void ActiveIndexRemove(IsraeliQueue q, Node node) {
+    if (node->m_activePrev) {
+        node->m_activePrev->m_activeNext = node->m_activeNext;
+    } else {
+        q->m_activeHead = node->m_activeNext;
     }
 
-    int size = 0;
-    for (Node curr = q->m_list; curr; curr = curr->m_next) {
-        size++;
+    if (node->m_activeNext) {
+        node->m_activeNext->m_activePrev = node->m_activePrev;
+    } else {
+        q->m_activeTail = node->m_activePrev;
     }
-    return size;
+
+    node->m_activePrev = NULL;
+    node->m_activeNext = NULL;
 }
 
-/**Removes and returns the foremost element of the provided queue. If the parameter
- * is NULL or a pointer to an empty queue, NULL is returned.*/
-void* IsraeliQueueDequeue(IsraeliQueue q) {
-    if (!q || !q->m_list) {
-        return NULL;
+// Recompute the tail, the size and the active index from the list itself.
+// Used after operations that move nodes around wholesale.
+void ActiveIndexRebuild(IsraeliQueue q) {
+    q->m_tail = NULL;
+    q->m_size = 0;
+    q->m_activeHead = NULL;
+    q->m_activeTail = NULL;
+    for (Node curr = q->m_list; curr; curr = curr->m_next) {
+        curr->m_activePrev = NULL;
+        curr->m_activeNext = NULL;
+        if (NodeIsActive(curr)) {
+            ActiveIndexInsertAfter(q, NULL, curr);
+        }
+        q->m_tail = curr;
+        q->m_size++;
     }
-
-    Node first = q->m_list;
-    q->m_list = q->m_list->m_next;
-    void* data = first->m_data;
-    free(first);
-    return data;
 }
 
-bool IsraeliQueueContains(IsraeliQueue q, void* data) {
-    if (!q || !data) {
-        return false;
+// Same as findFriendNotBlocked over the whole queue, but only walks the active
+// index, and only calls the friendship functions on nodes that can change the
+// result at that point of the scan. Returns the node to insert after, or NULL
+// if the queue is empty.
+Node findFriendNotBlockedIndexed(IsraeliQueue q, void* data, FriendStatus* outStatus) {
+    Node friend = NULL;
+    Node rival = NULL;
+
+    // Without any friendship measures, every pair is neutral.
+    if (q->m_friendshipsLength == 0) {
+        *outStatus = NEUTRAL;
+        return q->m_tail;
     }
 
-    for (Node curr = q->m_list; curr; curr = curr->m_next) {
-        if (q->m_compare(curr->m_data, data) == 0) {
-            return true;
+    if (q->m_pairCache) {
+        PairCacheSync(q);
+    }
+
+    for (Node curr = q->m_activeHead; curr != NULL; curr = curr->m_activeNext) {
+        FriendStatus status = scanElement(
+            q, data, curr->m_data, curr->m_friendsCalledOver, curr->m_rivalsBlocked, friend != NULL
+        );
+        if (status == FRIEND) {
+            friend = curr;
+        } else if (status == RIVAL) {
+            friend = NULL;
+            rival = curr;
         }
     }
-    return false;
+
+    *outStatus = friend ? FRIEND : rival ? RIVAL : NEUTRAL;
+    return friend ? friend : rival ? rival : q->m_tail;
 }
 
-IsraeliQueueError IsraeliQueueImprovePositionsRecursive(IsraeliQueue q, Node* nodePtr) {
-    if (!nodePtr) {
-        return ISRAELIQUEUE_SUCCESS;
-    }
+// Link a new node into the queue after the given node (or as the only node
+// if after is NULL), keeping the tail, the size and the active index up to date.
+// Updates the counters of after according to the given friendship status.
+void NodeLinkAfter(IsraeliQueue q, Node after, Node node, FriendStatus status) {
+    q->m_size++;
 
-    // Recurse.
-    IsraeliQueueError error = IsraeliQueueImprovePositionsRecursive(q, &(*nodePtr)->m_next);
-    if (error != ISRAELIQUEUE_SUCCESS) {
-        return error;
+    if (!after) {
+        q->m_list = node;
+        q->m_tail = node;
+        ActiveIndexInsertAfter(q, NULL, node);
+        return;
     }
 
-    FriendStatus status = 0;
-    Node* insertAfter = findFriendNotBlocked(q, &(*nodePtr)->m_data, *nodePtr, &status);
+    node->m_next = after->m_next;
+    after->m_next = node;
+    if (q->m_tail == after) {
+        q->m_tail = node;
+    }
 
-    NodeInsertAfter(insertAfter, nodePtr, status);
+    // A friend or rival is always active, so the node goes right after it in
+    // the index. A neutral insert is always at the end of the queue.
+    ActiveIndexInsertAfter(q, status == NEUTRAL ? NULL : after, node);
 
-    return ISRAELIQUEUE_SUCCESS;
+    // Only a friend or rival can have just used up its quotas. A neutral insert
+    // may follow a tail that is already out of the index.
+    if (status == FRIEND) {
+        after->m_friendsCalledOver++;
+    } else if (status == RIVAL) {
+        after->m_rivalsBlocked++;
+    }
+    if (status != NEUTRAL && !NodeIsActive(after)) {
+        ActiveIndexRemove(q, after);
+    }
 }
 
-IsraeliQueueError IsraeliQueueImprovePositions(IsraeliQueue q) {
-    return IsraeliQueueImprovePositionsRecursive(q, &q->m_list);
+
+// === Scan Functions ===
+
+// Returns the first none-blocked friend in front of stop. If all friends are
+// blocked, returns the last rival that is blocking. If no friends were found,
+// returns the node right before stop (NULL if stop is the first node).
+// According to those cases, sets the outStatus to the appropriate value.
+// Unlike findFriendNotBlockedIndexed, walks every node, as stop may not be in
+// the active index.
+Node findFriendNotBlocked(IsraeliQueue q, void* data, Node stop, FriendStatus* outStatus) {
+    Node friend = NULL;
+    Node rival = NULL;
+    Node last = NULL;
+
+    if (q->m_pairCache) {
+        PairCacheSync(q);
+    }
+
+    for (Node curr = q->m_list; curr != NULL && curr != stop; curr = curr->m_next) {
+        FriendStatus status = scanElement(
+            q, data, curr->m_data, curr->m_friendsCalledOver, curr->m_rivalsBlocked, friend != NULL
+        );
+        if (status == FRIEND) {
+            friend = curr;
+        } else if (status == RIVAL) {
+            friend = NULL;
+            rival = curr;
+        }
+        last = curr;
+    }
+
+    *outStatus = friend ? FRIEND : rival ? RIVAL : NEUTRAL;
+    return friend ? friend : rival ? rival : last;
+}
+
+
+// === Array Backend Functions ===
+
+// Physical index of the first element.
+int ArrayFirst(IsraeliQueue q) {
+    return q->m_head < q->m_gapStart ? q->m_head : q->m_gapEnd;
+}
+
+// Physical index of the element after the one at the given physical index.
+int ArrayNext(IsraeliQueue q, int physical) {
+    return physical + 1 == q->m_gapStart ? q->m_gapEnd : physical + 1;
+}
+
+// Physical index of the element at the given position in the queue.
+int ArrayPhysical(IsraeliQueue q, int position) {
+    int physical = q->m_head + position;
+    return physical < q->m_gapStart ? physical : physical + (q->m_gapEnd - q->m_gapStart);
+}
+
+// Move count elements of all three arrays from one physical index to another.
+void ArrayMove(IsraeliQueue q, int to, int from, int count) {
+    memmove(&q->m_items[to], &q->m_items[from], sizeof(void*) * count);
+    memmove(&q->m_itemsFriendsCalledOver[to], &q->m_itemsFriendsCalledOver[from], sizeof(int) * count);
+    memmove(&q->m_itemsRivalsBlocked[to], &q->m_itemsRivalsBlocked[from], sizeof(int) * count);
+}
+
+// Move the gap so that it starts right before the given position.
+void ArrayMoveGap(IsraeliQueue q, int position) {
+    int target = q->m_head + position;
+    if (target < q->m_gapStart) {
+        int count = q->m_gapStart - target;
+        ArrayMove(q, q->m_gapEnd - count, target, count);
+        q->m_gapStart -= count;
+        q->m_gapEnd -= count;
+    } else if (target > q->m_gapStart) {
+        int count = target - q->m_gapStart;
+        ArrayMove(q, q->m_gapStart, q->m_gapEnd, count);
+        q->m_gapStart += count;
+        q->m_gapEnd += count;
+    }
+}
+
+// Drop the queue's arrays, freeing them unless a snapshot still uses them.
+void ArrayRelease(IsraeliQueue q) {
+    if (!q->m_arraysReferences || --*q->m_arraysReferences == 0) {
+        free(q->m_items);
+        free(q->m_itemsFriendsCalledOver);
+        free(q->m_itemsRivalsBlocked);
+        free(q->m_arraysReferences);
+    }
+    q->m_arraysReferences = NULL;
+}
+
+// Reallocate the arrays with the given capacity, keeping the elements before
+// the gap at the start and the elements after it at the end.
+bool ArrayReallocate(IsraeliQueue q, int capacity) {
+    void** items = malloc(sizeof(void*) * capacity);
+    int* friendsCalledOver = malloc(sizeof(int) * capacity);
+    int* rivalsBlocked = malloc(sizeof(int) * capacity);
+    if (!items || !friendsCalledOver || !rivalsBlocked) {
+        free(items);
+        free(friendsCalledOver);
+        free(rivalsBlocked);
+        return false;
+    }
+
+    int before = q->m_gapStart - q->m_head;
+    int after = q->m_capacity - q->m_gapEnd;
+    if (before > 0) {
+        memcpy(items, &q->m_items[q->m_head], sizeof(void*) * before);
+        memcpy(friendsCalledOver, &q->m_itemsFriendsCalledOver[q->m_head], sizeof(int) * before);
+        memcpy(rivalsBlocked, &q->m_itemsRivalsBlocked[q->m_head], sizeof(int) * before);
+    }
+    if (after > 0) {
+        memcpy(&items[capacity - after], &q->m_items[q->m_gapEnd], sizeof(void*) * after);
+        memcpy(&friendsCalledOver[capacity - after], &q->m_itemsFriendsCalledOver[q->m_gapEnd], sizeof(int) * after);
+        memcpy(&rivalsBlocked[capacity - after], &q->m_itemsRivalsBlocked[q->m_gapEnd], sizeof(int) * after);
+    }
+
+    ArrayRelease(q);
+    q->m_items = items;
+    q->m_itemsFriendsCalledOver = friendsCalledOver;
+    q->m_itemsRivalsBlocked = rivalsBlocked;
+    q->m_capacity = capacity;
+    q->m_head = 0;
+    q->m_gapStart = before;
+    q->m_gapEnd = capacity - after;
+    return true;
+}
+
+// Give the queue its own copy of its arrays before writing to them, if they are
+// shared with a snapshot, with room for at least the given number of elements
+// more. Returns false if the copy could not be allocated.
+bool ArrayMakeWritable(IsraeliQueue q, int room) {
+    if (!q->m_arraysReferences) {
+        return true;
+    }
+    if (*q->m_arraysReferences == 1) {
+        free(q->m_arraysReferences);
+        q->m_arraysReferences = NULL;
+        return true;
+    }
+
+    int size = q->m_size + room;
+    return ArrayReallocate(q, size * 2 > ARRAY_MIN_CAPACITY ? size * 2 : ARRAY_MIN_CAPACITY);
+}
+
+// Insert an item with zeroed counters at the given position.
+IsraeliQueueError ArrayInsert(IsraeliQueue q, int position, void* data) {
+    ArrayMoveGap(q, position);
+    if (q->m_gapStart == q->m_gapEnd) {
+        // Size the arrays by the elements, so space freed by dequeues is reclaimed.
+        int capacity = q->m_size * 2 > ARRAY_MIN_CAPACITY ? q->m_size * 2 : ARRAY_MIN_CAPACITY;
+        if (!ArrayReallocate(q, capacity)) {
+            return ISRAELIQUEUE_ALLOC_FAILED;
+        }
+    }
+
+    q->m_items[q->m_gapStart] = data;
+    q->m_itemsFriendsCalledOver[q->m_gapStart] = 0;
+    q->m_itemsRivalsBlocked[q->m_gapStart] = 0;
+    q->m_gapStart++;
+    q->m_size++;
+    return ISRAELIQUEUE_SUCCESS;
+}
+
+// Same as findFriendNotBlocked, over the elements before position stop.
+// Returns the position to insert after, or -1 if stop is 0.
+int ArrayFindFriendNotBlocked(IsraeliQueue q, void* data, int stop, FriendStatus* outStatus) {
+    int friend = -1;
+    int rival = -1;
+
+    // Without any friendship measures, every pair is neutral.
+    if (q->m_friendshipsLength == 0) {
+        *outStatus = NEUTRAL;
+        return stop - 1;
+    }
+
+    if (q->m_pairCache) {
+        PairCacheSync(q);
+    }
+
+    int physical = ArrayFirst(q);
+    for (int i = 0; i < stop; i++, physical = ArrayNext(q, physical)) {
+        FriendStatus status = scanElement(
+            q, data, q->m_items[physical], q->m_itemsFriendsCalledOver[physical],
+            q->m_itemsRivalsBlocked[physical], friend != -1
+        );
+        if (status == FRIEND) {
+            friend = i;
+        } else if (status == RIVAL) {
+            friend = -1;
+            rival = i;
+        }
+    }
+
+    *outStatus = friend != -1 ? FRIEND : rival != -1 ? RIVAL : NEUTRAL;
+    return friend != -1 ? friend : rival != -1 ? rival : stop - 1;
+}
+
+// Update the counters of the element at the given position after an item
+// was placed behind it with the given friendship status.
+void ArrayCountPlacement(IsraeliQueue q, int position, FriendStatus status) {
+    if (status == FRIEND) {
+        q->m_itemsFriendsCalledOver[ArrayPhysical(q, position)]++;
+    } else if (status == RIVAL) {
+        q->m_itemsRivalsBlocked[ArrayPhysical(q, position)]++;
+    }
+}
+
+IsraeliQueueError ArrayEnqueue(IsraeliQueue q, void* data) {
+    if (!ArrayMakeWritable(q, 1)) {
+        return ISRAELIQUEUE_ALLOC_FAILED;
+    }
+
+    FriendStatus status = NEUTRAL;
+    int insertAfter = ArrayFindFriendNotBlocked(q, data, q->m_size, &status);
+
+    IsraeliQueueError error = ArrayInsert(q, insertAfter + 1, data);
+    if (error != ISRAELIQUEUE_SUCCESS) {
+        return error;
+    }
+
+    ArrayCountPlacement(q, insertAfter, status);
+    return ISRAELIQUEUE_SUCCESS;
+}
+
+IsraeliQueueError ArrayEnqueueMany(IsraeliQueue q, void** items, int n) {
+    // Make room for all the items up front, so placing them cannot fail.
+    int room = q->m_gapEnd - q->m_gapStart;
+    if (room < n) {
+        int capacity = (q->m_size + n) * 2 > ARRAY_MIN_CAPACITY ? (q->m_size + n) * 2 : ARRAY_MIN_CAPACITY;
+        if (!ArrayReallocate(q, capacity)) {
+            return ISRAELIQUEUE_ALLOC_FAILED;
+        }
+    } else if (!ArrayMakeWritable(q, n)) {
+        return ISRAELIQUEUE_ALLOC_FAILED;
+    }
+
+    for (int i = 0; i < n; i++) {
+        IsraeliQueueError error = ArrayEnqueue(q, items[i]);
+        if (error != ISRAELIQUEUE_SUCCESS) {
+            return error;
+        }
+    }
+    return ISRAELIQUEUE_SUCCESS;
+}
+
+void* ArrayDequeue(IsraeliQueue q) {
+    if (q->m_size == 0) {
+        return NULL;
+    }
+
+    void* data = q->m_items[ArrayFirst(q)];
+    if (q->m_head < q->m_gapStart) {
+        q->m_head++;
+    } else {
+        q->m_gapEnd++;
+    }
+    q->m_size--;
+
+    // Start over from the beginning of the arrays once the queue is empty.
+    if (q->m_size == 0) {
+        q->m_head = 0;
+        q->m_gapStart = 0;
+        q->m_gapEnd = q->m_capacity;
+    }
+
+    return data;
+}
+
+// Rotate the elements in positions [from, to] so the one at to moves to from.
+// Expects the gap to be after position to.
+void ArrayRotateRight(IsraeliQueue q, int from, int to) {
+    int first = q->m_head + from;
+    int last = q->m_head + to;
+    void* item = q->m_items[last];
+    int friendsCalledOver = q->m_itemsFriendsCalledOver[last];
+    int rivalsBlocked = q->m_itemsRivalsBlocked[last];
+
+    ArrayMove(q, first + 1, first, last - first);
+    q->m_items[first] = item;
+    q->m_itemsFriendsCalledOver[first] = friendsCalledOver;
+    q->m_itemsRivalsBlocked[first] = rivalsBlocked;
+}
+
+IsraeliQueueError ArrayImprovePositions(IsraeliQueue q) {
+    int size = q->m_size;
+    if (size == 0) {
+        return ISRAELIQUEUE_SUCCESS;
+    }
+    if (!ArrayMakeWritable(q, 0)) {
+        return ISRAELIQUEUE_ALLOC_FAILED;
+    }
+
+    // Tracks which original element is at each position, so the elements can
+    // be visited from the back frontwards while they move around.
+    int* order = malloc(sizeof(int) * size);
+    if (!order) {
+        return ISRAELIQUEUE_ALLOC_FAILED;
+    }
+    for (int i = 0; i < size; i++) {
+        order[i] = i;
+    }
+
+    // Keep all elements contiguous, so positions map directly to indices.
+    ArrayMoveGap(q, size);
+
+    for (int original = size - 1; original >= 0; original--) {
+        int position = original;
+        while (order[position] != original) {
+            position++;
+        }
+
+        FriendStatus status = NEUTRAL;
+        int insertAfter = ArrayFindFriendNotBlocked(q, q->m_items[q->m_head + position], position, &status);
+        ArrayCountPlacement(q, insertAfter, status);
+
+        if (insertAfter + 1 < position) {
+            ArrayRotateRight(q, insertAfter + 1, position);
+            memmove(&order[insertAfter + 2], &order[insertAfter + 1], sizeof(int) * (position - insertAfter - 1));
+            order[insertAfter + 1] = original;
+        }
+    }
+
+    free(order);
+    return ISRAELIQUEUE_SUCCESS;
+}
+
+
+// === Implementation ===
+
+IsraeliQueue IsraeliQueueCreate(FriendshipFunction* friendships, ComparisonFunction compare, int friendshipThreshold, int rivalryThreshold) {
+    return IsraeliQueueCreateWithBackend(friendships, compare, friendshipThreshold, rivalryThreshold, ISRAELIQUEUE_LINKED_LIST);
+}
+
+IsraeliQueue IsraeliQueueCreateWithBackend(FriendshipFunction* friendships, ComparisonFunction compare,
+                                           int friendshipThreshold, int rivalryThreshold,
+                                           IsraeliQueueBackend backend)
+{
+    IsraeliQueue ret = (IsraeliQueue)malloc(sizeof(struct IsraeliQueue_t));
+
+    // Return early if malloc failed.
+    if (!ret) {
+        return NULL;
+    }
+
+    // Copy the friendship functions.
+    int functions = sizeOfFriendshipArray(friendships);
+    FriendshipFunction* friendshipsCopied = (FriendshipFunction*)copyToMalloc(friendships, sizeof(FriendshipFunction) * (functions + 1));
+
+    ret->m_backend = backend;
+    ret->m_size = 0;
+    ret->m_pool = NULL;
+    ret->m_list = NULL;
+    ret->m_tail = NULL;
+    ret->m_activeHead = NULL;
+    ret->m_activeTail = NULL;
+    ret->m_items = NULL;
+    ret->m_itemsFriendsCalledOver = NULL;
+    ret->m_itemsRivalsBlocked = NULL;
+    ret->m_capacity = 0;
+    ret->m_head = 0;
+    ret->m_gapStart = 0;
+    ret->m_gapEnd = 0;
+    ret->m_arraysReferences = NULL;
+    ret->m_friendships = friendshipsCopied;
+    ret->m_friendshipsLength = functions;
+    ret->m_scorer = NULL;
+    ret->m_measureOrder = ISRAELIQUEUE_ORDER_REGISTRATION;
+    ret->m_measures = NULL;
+    ret->m_measureSequence = NULL;
+    ret->m_measureValues = NULL;
+    ret->m_measuresLength = 0;
+    ret->m_measuresScored = 0;
+    ret->m_measuresLowerBounds = 0;
+    ret->m_measuresUnbounded = 0;
+    ret->m_compare = compare;
+    ret->m_friendshipThreshold = friendshipThreshold;
+    ret->m_rivalryThreshold = rivalryThreshold;
+    ret->m_pairCache = NULL;
+    ret->m_combiner = NULL;
+    return ret;
+}
+
+// Create an empty queue with the same friendship functions, thresholds and
+// measure settings as the given one.
+IsraeliQueue CreateLike(IsraeliQueue q) {
+    IsraeliQueue out = IsraeliQueueCreateWithBackend(
+        q->m_friendships, q->m_compare, q->m_friendshipThreshold, q->m_rivalryThreshold, q->m_backend
+    );
+    if (!out) {
+        return NULL;
+    }
+    out->m_scorer = q->m_scorer;
+
+    // Copies allocate from the same pool, and share the pair cache.
+    if (q->m_pool && q->m_backend == ISRAELIQUEUE_LINKED_LIST) {
+        IsraeliQueueSetNodePool(out, q->m_pool);
+    }
+    if (q->m_pairCache) {
+        IsraeliQueueSetPairCache(out, q->m_pairCache);
+    }
+
+    // The clone keeps the measure order and bounds, but collects its own statistics.
+    if (q->m_measures) {
+        if (!MeasuresResize(out, q->m_measuresLength)) {
+            IsraeliQueueDestroy(out);
+            return NULL;
+        }
+        for (int i = 0; i < q->m_measuresLength; i++) {
+            out->m_measures[i].m_lowerBound = q->m_measures[i].m_lowerBound;
+            out->m_measures[i].m_bounded = q->m_measures[i].m_bounded;
+            out->m_measureSequence[i] = q->m_measureSequence[i];
+        }
+        out->m_measuresLowerBounds = q->m_measuresLowerBounds;
+        out->m_measuresUnbounded = q->m_measuresUnbounded;
+        out->m_measureOrder = q->m_measureOrder;
+    }
+    return out;
+}
+
+IsraeliQueue IsraeliQueueCreateConcurrent(FriendshipFunction* friendships, ComparisonFunction compare, int friendshipThreshold, int rivalryThreshold) {
+    IsraeliQueue q = IsraeliQueueCreate(friendships, compare, friendshipThreshold, rivalryThreshold);
+    if (!q) {
+        return NULL;
+    }
+
+    q->m_combiner = (Combiner*)malloc(sizeof(Combiner));
+    if (!q->m_combiner || pthread_mutex_init(&q->m_combiner->m_lock, NULL) != 0) {
+        free(q->m_combiner);
+        q->m_combiner = NULL;
+        IsraeliQueueDestroy(q);
+        return NULL;
+    }
+    q->m_combiner->m_published = NULL;
+    q->m_combiner->m_size = 0;
+    return q;
+}
+
+IsraeliQueue IsraeliQueueClone(IsraeliQueue q) {
+    IsraeliQueue out = CreateLike(q);
+    if (!out) {
+        return NULL;
+    }
+
+    if (q->m_backend == ISRAELIQUEUE_ARRAY) {
+        // Copy the elements over, without the gap.
+        if (q->m_size > 0) {
+            if (!ArrayReallocate(out, q->m_size)) {
+                IsraeliQueueDestroy(out);
+                return NULL;
+            }
+            int physical = ArrayFirst(q);
+            for (int i = 0; i < q->m_size; i++, physical = ArrayNext(q, physical)) {
+                out->m_items[i] = q->m_items[physical];
+                out->m_itemsFriendsCalledOver[i] = q->m_itemsFriendsCalledOver[physical];
+                out->m_itemsRivalsBlocked[i] = q->m_itemsRivalsBlocked[physical];
+            }
+            out->m_gapStart = q->m_size;
+            out->m_gapEnd = q->m_size;
+            out->m_size = q->m_size;
+        }
+        return out;
+    }
+
+    // Clone over the data.
+    Node* outNode = &out->m_list;
+    for (Node inNode = q->m_list; inNode != NULL; inNode = inNode->m_next) {
+        *outNode = NodeCreate(out, inNode->m_data, NULL);
+        (*outNode)->m_friendsCalledOver = inNode->m_friendsCalledOver;
+        (*outNode)->m_rivalsBlocked = inNode->m_rivalsBlocked;
+        outNode = &(*outNode)->m_next;
+    }
+    ActiveIndexRebuild(out);
+    return out;
+}
+
+IsraeliQueue IsraeliQueueSnapshot(IsraeliQueue q) {
+    if (!q) {
+        return NULL;
+    }
+    // Only arrays can be shared, so linked lists are copied.
+    if (q->m_backend != ISRAELIQUEUE_ARRAY) {
+        return IsraeliQueueClone(q);
+    }
+
+    if (!q->m_arraysReferences) {
+        q->m_arraysReferences = malloc(sizeof(int));
+        if (!q->m_arraysReferences) {
+            return NULL;
+        }
+        *q->m_arraysReferences = 1;
+    }
+
+    IsraeliQueue out = CreateLike(q);
+    if (!out) {
+        return NULL;
+    }
+
+    // Share the arrays, positions included, until either queue writes to them.
+    out->m_items = q->m_items;
+    out->m_itemsFriendsCalledOver = q->m_itemsFriendsCalledOver;
+    out->m_itemsRivalsBlocked = q->m_itemsRivalsBlocked;
+    out->m_capacity = q->m_capacity;
+    out->m_head = q->m_head;
+    out->m_gapStart = q->m_gapStart;
+    out->m_gapEnd = q->m_gapEnd;
+    out->m_size = q->m_size;
+    out->m_arraysReferences = q->m_arraysReferences;
+    (*q->m_arraysReferences)++;
+    return out;
+}
+
+void IsraeliQueueDestroy(IsraeliQueue q) {
+    // Exit early if the queue is already NULL.
+    if (!q) {
+        return;
+    }
+
+    // A private pool is freed as a whole, so only return the nodes to a
+    // pool that other queues still use.
+    if (q->m_pool && q->m_pool->m_references > 1 && q->m_list) {
+        NodePoolFreeList(q->m_pool, q->m_list, q->m_tail);
+    }
+    NodePoolRelease(q->m_pool);
+
+    ArrayRelease(q);
+
+    PairCacheRelease(q->m_pairCache);
+    if (q->m_combiner) {
+        pthread_mutex_destroy(&q->m_combiner->m_lock);
+        free(q->m_combiner);
+    }
+    free(q->m_measures);
+    free(q->m_measureSequence);
+    free(q->m_measureValues);
+    free(q->m_friendships);
+    free(q);
+}
+
+// Enqueue without regard to other threads.
+IsraeliQueueError QueueEnqueue(IsraeliQueue q, void* data) {
+    if (q->m_backend == ISRAELIQUEUE_ARRAY) {
+        return ArrayEnqueue(q, data);
+    }
+
+    FriendStatus status = 0;
+    Node insertAfter = findFriendNotBlockedIndexed(q, data, &status);
+
+    Node toInsert = NodeCreate(q, data, NULL);
+    if (!toInsert) {
+        return ISRAELIQUEUE_ALLOC_FAILED;
+    }
+
+    NodeLinkAfter(q, insertAfter, toInsert, status);
+    return ISRAELIQUEUE_SUCCESS;
+}
+
+// Orders pointers by address, for qsort.
+int comparePointers(const void* first, const void* second) {
+    uintptr_t a = (uintptr_t)*(void* const*)first;
+    uintptr_t b = (uintptr_t)*(void* const*)second;
+    return a < b ? -1 : a > b;
+}
+
+// Whether an item appears more than once in the batch. Returns false if the
+// items could not be sorted.
+bool BatchRepeatsItem(void** items, int n) {
+    void** sorted = copyToMalloc(items, sizeof(void*) * n);
+    if (!sorted) {
+        return false;
+    }
+
+    qsort(sorted, n, sizeof(void*), comparePointers);
+    bool repeats = false;
+    for (int i = 1; i < n && !repeats; i++) {
+        repeats = sorted[i] == sorted[i - 1];
+    }
+    free(sorted);
+    return repeats;
+}
+
+// QueueEnqueueMany for linked list backed queues.
+IsraeliQueueError ListEnqueueMany(IsraeliQueue q, void** items, int n) {
+    // Allocate all the nodes up front, chained in order, so the queue is left
+    // untouched if any allocation fails.
+    Node first = NULL;
+    Node last = NULL;
+    for (int i = n - 1; i >= 0; i--) {
+        Node node = NodeCreate(q, items[i], first);
+        if (!node) {
+            if (first) {
+                NodePoolFreeList(q->m_pool, first, last);
+            }
+            return ISRAELIQUEUE_ALLOC_FAILED;
+        }
+        last = last ? last : node;
+        first = node;
+    }
+
+    // Place the nodes one after the other. Without friendship measures the
+    // scan is skipped and this is a plain append.
+    while (first) {
+        Node node = first;
+        first = first->m_next;
+
+        FriendStatus status = NEUTRAL;
+        Node insertAfter = findFriendNotBlockedIndexed(q, node->m_data, &status);
+        node->m_next = NULL;
+        NodeLinkAfter(q, insertAfter, node, status);
+    }
+
+    return ISRAELIQUEUE_SUCCESS;
+}
+
+// Place the items one after the other, like QueueEnqueue would. Each placement
+// looks up the statuses of its item against the whole queue, so a batch that
+// holds an item more than once looks up the same pairs again. Such a batch is
+// placed with a pair cache of its own, unless the queue already has one, so
+// every status is computed once for the whole batch.
+IsraeliQueueError QueueEnqueueMany(IsraeliQueue q, void** items, int n) {
+    IsraeliQueuePairCache batchCache = NULL;
+    if (!q->m_pairCache && q->m_friendshipsLength > 0 && n > 1 && BatchRepeatsItem(items, n)) {
+        batchCache = IsraeliQueuePairCacheCreate();
+        q->m_pairCache = batchCache;
+    }
+
+    IsraeliQueueError error = q->m_backend == ISRAELIQUEUE_ARRAY ? ArrayEnqueueMany(q, items, n)
+                                                                 : ListEnqueueMany(q, items, n);
+    if (batchCache) {
+        q->m_pairCache = NULL;
+        PairCacheRelease(batchCache);
+    }
+    return error;
+}
+
+IsraeliQueueError IsraeliQueueAddFriendshipMeasure(IsraeliQueue q, FriendshipFunction function) {
+    FriendshipFunction* friendships = (FriendshipFunction*)copyToMallocResize(
+        q->m_friendships,
+        (q->m_friendshipsLength + 1) * sizeof(FriendshipFunction),
+        (q->m_friendshipsLength + 2) * sizeof(FriendshipFunction)
+    );
+    
+    if (!friendships) {
+        return ISRAELIQUEUE_ALLOC_FAILED;
+    }
+    if (q->m_measures && !MeasuresResize(q, q->m_friendshipsLength + 1)) {
+        free(friendships);
+        return ISRAELIQUEUE_ALLOC_FAILED;
+    }
+
+    friendships[q->m_friendshipsLength] = function;
+    friendships[q->m_friendshipsLength + 1] = NULL;
+
+    free(q->m_friendships);
+    q->m_friendships = friendships;
+    q->m_friendshipsLength++;
+
+    // The scorer does not know about the new function.
+    q->m_scorer = NULL;
+
+    return ISRAELIQUEUE_SUCCESS;
+}
+
+IsraeliQueueError IsraeliQueueSetFriendshipScorer(IsraeliQueue q, FriendshipScorer scorer) {
+    if (!q) {
+        return ISRAELIQUEUE_BAD_PARAM;
+    }
+
+    q->m_scorer = scorer;
+    return ISRAELIQUEUE_SUCCESS;
+}
+
+IsraeliQueueError IsraeliQueueSetMeasureOrder(IsraeliQueue q, IsraeliQueueMeasureOrder order) {
+    if (!q) {
+        return ISRAELIQUEUE_BAD_PARAM;
+    }
+    if (!q->m_measures && !MeasuresResize(q, q->m_friendshipsLength)) {
+        return ISRAELIQUEUE_ALLOC_FAILED;
+    }
+
+    q->m_measureOrder = order;
+    q->m_measuresScored = 0;
+    if (order == ISRAELIQUEUE_ORDER_REGISTRATION) {
+        MeasuresReorder(q);
+    }
+    return ISRAELIQUEUE_SUCCESS;
+}
+
+IsraeliQueueError IsraeliQueueSetMeasureLowerBound(IsraeliQueue q, FriendshipFunction function, int lowerBound) {
+    if (!q) {
+        return ISRAELIQUEUE_BAD_PARAM;
+    }
+    if (!q->m_measures && !MeasuresResize(q, q->m_friendshipsLength)) {
+        return ISRAELIQUEUE_ALLOC_FAILED;
+    }
+
+    bool found = false;
+    for (int i = 0; i < q->m_friendshipsLength; i++) {
+        if (q->m_friendships[i] == function) {
+            if (q->m_measures[i].m_bounded) {
+                q->m_measuresLowerBounds -= q->m_measures[i].m_lowerBound;
+            } else {
+                q->m_measuresUnbounded--;
+            }
+            q->m_measures[i].m_lowerBound = lowerBound;
+            q->m_measures[i].m_bounded = true;
+            q->m_measuresLowerBounds += lowerBound;
+            found = true;
+        }
+    }
+    return found ? ISRAELIQUEUE_SUCCESS : ISRAELIQUEUE_BAD_PARAM;
+}
+
+IsraeliQueueError IsraeliQueueGetMeasureStats(IsraeliQueue q, int index, long long* calls, long long* exits,
+                                              double* nanosecondsPerCall, int* position)
+{
+    if (!q || index < 0 || index >= q->m_friendshipsLength) {
+        return ISRAELIQUEUE_BAD_PARAM;
+    }
+
+    MeasureInfo info = { 0 };
+    int at = index;
+    if (q->m_measures) {
+        info = q->m_measures[index];
+        for (int k = 0; k < q->m_measuresLength; k++) {
+            at = q->m_measureSequence[k] == index ? k : at;
+        }
+    }
+
+    if (calls) {
+        *calls = info.m_calls;
+    }
+    if (exits) {
+        *exits = info.m_exits;
+    }
+    if (nanosecondsPerCall) {
+        *nanosecondsPerCall = info.m_timedCalls ? (double)info.m_timedNanoseconds / info.m_timedCalls : 0;
+    }
+    if (position) {
+        *position = at;
+    }
+    return ISRAELIQUEUE_SUCCESS;
+}
+
+IsraeliQueueError IsraeliQueueUpdateFriendshipThreshold(IsraeliQueue q, int friendshipThreshold) {
+    if (friendshipThreshold < 0) {
+        return ISRAELIQUEUE_BAD_PARAM;
+    }
+
+    q->m_friendshipThreshold = friendshipThreshold;
+    return ISRAELIQUEUE_SUCCESS;
+}
+
+IsraeliQueueError IsraeliQueueUpdateRivalryThreshold(IsraeliQueue q, int rivalryThreshold) {
+    if (rivalryThreshold < 0) {
+        return ISRAELIQUEUE_BAD_PARAM;
+    }
+
+    q->m_rivalryThreshold = rivalryThreshold;
+    return ISRAELIQUEUE_SUCCESS;
+}
+
+/**Returns the number of elements of the given queue. If the parameter is NULL, 0
+ * is returned.*/
+int IsraeliQueueSize(IsraeliQueue q) {
+    if (!q) {
+        return 0;
+    }
+    if (q->m_combiner) {
+        return __atomic_load_n(&q->m_combiner->m_size, __ATOMIC_ACQUIRE);
+    }
+
+    return q->m_size;
+}
+
+// Dequeue without regard to other threads.
+void* QueueDequeue(IsraeliQueue q) {
+    if (q->m_backend == ISRAELIQUEUE_ARRAY) {
+        return ArrayDequeue(q);
+    }
+
+    if (!q->m_list) {
+        return NULL;
+    }
+
+    Node first = q->m_list;
+    q->m_list = q->m_list->m_next;
+    if (NodeIsActive(first)) {
+        ActiveIndexRemove(q, first);
+    }
+    if (q->m_tail == first) {
+        q->m_tail = NULL;
+    }
+    q->m_size--;
+    void* data = first->m_data;
+    NodePoolFree(q->m_pool, first);
+    return data;
+}
+
+// === Concurrent Queue Functions ===
+
+// Push a request onto the published ones.
+void CombinerPublish(Combiner* combiner, CombiningRequest* request) {
+    CombiningRequest* head = __atomic_load_n(&combiner->m_published, __ATOMIC_RELAXED);
+    do {
+        request->m_next = head;
+    } while (!__atomic_compare_exchange_n(&combiner->m_published, &head, request, true,
+                                          __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+// Carry out all the published requests, in the order they were published.
+// Expects the lock to be held.
+void CombinerRun(IsraeliQueue q) {
+    Combiner* combiner = q->m_combiner;
+
+    // The requests were pushed onto a stack, so reverse them first.
+    CombiningRequest* request = __atomic_exchange_n(&combiner->m_published, NULL, __ATOMIC_ACQUIRE);
+    CombiningRequest* ordered = NULL;
+    while (request) {
+        CombiningRequest* next = request->m_next;
+        request->m_next = ordered;
+        ordered = request;
+        request = next;
+    }
+
+    while (ordered) {
+        // A request lives on its thread's stack, which may be gone once it is done.
+        CombiningRequest* next = ordered->m_next;
+        if (ordered->m_dequeue) {
+            ordered->m_data = QueueDequeue(q);
+        } else {
+            ordered->m_error = QueueEnqueue(q, ordered->m_data);
+        }
+        __atomic_store_n(&combiner->m_size, q->m_size, __ATOMIC_RELEASE);
+        __atomic_store_n(&ordered->m_done, 1, __ATOMIC_RELEASE);
+        ordered = next;
+    }
+}
+
+// Publish a request and wait until it is carried out, carrying out every
+// published request whenever the lock is free.
+void CombinerSubmit(IsraeliQueue q, CombiningRequest* request) {
+    Combiner* combiner = q->m_combiner;
+    request->m_done = 0;
+    CombinerPublish(combiner, request);
+
+    while (!__atomic_load_n(&request->m_done, __ATOMIC_ACQUIRE)) {
+        if (pthread_mutex_trylock(&combiner->m_lock) == 0) {
+            CombinerRun(q);
+            pthread_mutex_unlock(&combiner->m_lock);
+        } else {
+            sched_yield();
+        }
+    }
+}
+
+
+IsraeliQueueError IsraeliQueueEnqueue(IsraeliQueue q, void* data) {
+    if (!q->m_combiner) {
+        return QueueEnqueue(q, data);
+    }
+
+    CombiningRequest request = { false, data, ISRAELIQUEUE_SUCCESS, 0, NULL };
+    CombinerSubmit(q, &request);
+    return request.m_error;
+}
+
+IsraeliQueueError IsraeliQueueEnqueueMany(IsraeliQueue q, void** items, int n) {
+    if (!q || n < 0 || (n > 0 && !items)) {
+        return ISRAELIQUEUE_BAD_PARAM;
+    }
+    if (!q->m_combiner) {
+        return QueueEnqueueMany(q, items, n);
+    }
+
+    // The items are placed together, after the requests published before them.
+    pthread_mutex_lock(&q->m_combiner->m_lock);
+    CombinerRun(q);
+    IsraeliQueueError error = QueueEnqueueMany(q, items, n);
+    __atomic_store_n(&q->m_combiner->m_size, q->m_size, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&q->m_combiner->m_lock);
+    return error;
+}
+
+void* IsraeliQueueDequeue(IsraeliQueue q) {
+    if (!q) {
+        return NULL;
+    }
+    if (!q->m_combiner) {
+        return QueueDequeue(q);
+    }
+
+    CombiningRequest request = { true, NULL, ISRAELIQUEUE_SUCCESS, 0, NULL };
+    CombinerSubmit(q, &request);
+    return request.m_data;
+}
+
+bool IsraeliQueueContains(IsraeliQueue q, void* data) {
+    if (!q || !data) {
+        return false;
+    }
+
+    if (q->m_backend == ISRAELIQUEUE_ARRAY) {
+        int physical = ArrayFirst(q);
+        for (int i = 0; i < q->m_size; i++, physical = ArrayNext(q, physical)) {
+            if (q->m_compare(q->m_items[physical], data) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    for (Node curr = q->m_list; curr; curr = curr->m_next) {
+        if (q->m_compare(curr->m_data, data) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// The position of the foremost element equal to the data among the first
+// limit elements of the queue, or -1 if there is none.
+int findPosition(IsraeliQueue q, void* data, int limit) {
+    IsraeliQueueCursor cursor = IsraeliQueueBegin(q);
+    for (int i = 0; i < limit && i < q->m_size; i++) {
+        void* element = IsraeliQueueCursorNext(&cursor);
+        if (q->m_compare ? q->m_compare(element, data) == 0 : element == data) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int IsraeliQueuePositionOf(IsraeliQueue q, void* data) {
+    if (!q || !data) {
+        return -1;
+    }
+
+    return findPosition(q, data, q->m_size);
+}
+
+bool IsraeliQueueIsWithinFirst(IsraeliQueue q, void* data, int k) {
+    if (!q || !data) {
+        return false;
+    }
+
+    return findPosition(q, data, k) >= 0;
+}
+
+IsraeliQueueCursor IsraeliQueueBegin(IsraeliQueue q) {
+    IsraeliQueueCursor cursor = { q, NULL, 0, 0 };
+    if (q && q->m_backend == ISRAELIQUEUE_ARRAY) {
+        cursor.m_physical = ArrayFirst(q);
+    } else if (q) {
+        cursor.m_node = q->m_list;
+    }
+    return cursor;
+}
+
+void* IsraeliQueueCursorPeek(const IsraeliQueueCursor* cursor) {
+    IsraeliQueue q = cursor->m_queue;
+    if (!q || cursor->m_position >= q->m_size) {
+        return NULL;
+    }
+
+    if (q->m_backend == ISRAELIQUEUE_ARRAY) {
+        return q->m_items[cursor->m_physical];
+    }
+    return ((Node)cursor->m_node)->m_data;
+}
+
+void* IsraeliQueueCursorNext(IsraeliQueueCursor* cursor) {
+    if (!cursor->m_queue || cursor->m_position >= cursor->m_queue->m_size) {
+        return NULL;
+    }
+    void* data = IsraeliQueueCursorPeek(cursor);
+
+    if (cursor->m_queue->m_backend == ISRAELIQUEUE_ARRAY) {
+        cursor->m_physical = ArrayNext(cursor->m_queue, cursor->m_physical);
+    } else {
+        cursor->m_node = ((Node)cursor->m_node)->m_next;
+    }
+    cursor->m_position++;
+    return data;
+}
+
+void* IsraeliQueuePeekAt(IsraeliQueue q, int index) {
+    if (!q || index < 0 || index >= q->m_size) {
+        return NULL;
+    }
+
+    if (q->m_backend == ISRAELIQUEUE_ARRAY) {
+        return q->m_items[ArrayPhysical(q, index)];
+    }
+
+    Node curr = q->m_list;
+    for (int i = 0; i < index; i++) {
+        curr = curr->m_next;
+    }
+    return curr->m_data;
+}
+
+int IsraeliQueueToArray(IsraeliQueue q, void** buffer, int capacity) {
+    if (!q || !buffer || capacity <= 0) {
+        return 0;
+    }
+    int count = capacity < q->m_size ? capacity : q->m_size;
+    if (count == 0) {
+        return 0;
+    }
+
+    // The elements before the gap, then the ones after it.
+    if (q->m_backend == ISRAELIQUEUE_ARRAY) {
+        int beforeGap = q->m_gapStart - q->m_head;
+        beforeGap = beforeGap < count ? beforeGap : count;
+        memcpy(buffer, &q->m_items[q->m_head], sizeof(void*) * beforeGap);
+        memcpy(buffer + beforeGap, &q->m_items[q->m_gapEnd], sizeof(void*) * (count - beforeGap));
+        return count;
+    }
+
+    Node curr = q->m_list;
+    for (int i = 0; i < count; i++, curr = curr->m_next) {
+        buffer[i] = curr->m_data;
+    }
+    return count;
+}
+
+IsraeliQueueError IsraeliQueueForEach(IsraeliQueue q, IsraeliQueueVisitor visitor, void* context) {
+    if (!q || !visitor) {
+        return ISRAELIQUEUE_BAD_PARAM;
+    }
+
+    IsraeliQueueCursor cursor = IsraeliQueueBegin(q);
+    for (int i = 0; i < q->m_size && visitor(IsraeliQueueCursorNext(&cursor), context); i++) {
+    }
+    return ISRAELIQUEUE_SUCCESS;
+}
+
+IsraeliQueueError IsraeliQueueImprovePositions(IsraeliQueue q) {
+    if (q->m_backend == ISRAELIQUEUE_ARRAY) {
+        return ArrayImprovePositions(q);
+    }
+
+    // Without any friendship measures, no node can move.
+    if (q->m_size == 0 || q->m_friendshipsLength == 0) {
+        return ISRAELIQUEUE_SUCCESS;
+    }
+
+    // Remember the original order, so the nodes can be visited from the back
+    // frontwards while they move around.
+    Node* nodes = malloc(sizeof(Node) * q->m_size);
+    if (!nodes) {
+        return ISRAELIQUEUE_ALLOC_FAILED;
+    }
+    int i = 0;
+    for (Node curr = q->m_list; curr; curr = curr->m_next) {
+        nodes[i++] = curr;
+    }
+
+    for (i = q->m_size - 1; i >= 0; i--) {
+        Node node = nodes[i];
+        FriendStatus status = NEUTRAL;
+        Node insertAfter = findFriendNotBlocked(q, node->m_data, node, &status);
+        if (status == NEUTRAL) {
+            continue;
+        }
+
+        if (status == FRIEND) {
+            insertAfter->m_friendsCalledOver++;
+        } else {
+            insertAfter->m_rivalsBlocked++;
+        }
+
+        // Unless it is already right behind it, move the node behind insertAfter.
+        if (insertAfter->m_next != node) {
+            Node previous = insertAfter;
+            while (previous->m_next != node) {
+                previous = previous->m_next;
+            }
+            previous->m_next = node->m_next;
+            node->m_next = insertAfter->m_next;
+            insertAfter->m_next = node;
+        }
+    }
+
+    free(nodes);
+
+    // Nodes were moved around, so the tail and the index no longer follow the list.
+    ActiveIndexRebuild(q);
+    return ISRAELIQUEUE_SUCCESS;
+}
+
+IsraeliQueueNodePool IsraeliQueueNodePoolCreate(void) {
+    IsraeliQueueNodePool pool = (IsraeliQueueNodePool)malloc(sizeof(struct IsraeliQueueNodePool_t));
+    if (!pool) {
+        return NULL;
+    }
+
+    pool->m_slabs = NULL;
+    pool->m_slabUsed = 0;
+    pool->m_free = NULL;
+    pool->m_references = 1;
+    return pool;
+}
+
+void IsraeliQueueNodePoolDestroy(IsraeliQueueNodePool pool) {
+    NodePoolRelease(pool);
+}
+
+IsraeliQueueError IsraeliQueueSetNodePool(IsraeliQueue q, IsraeliQueueNodePool pool) {
+    if (!q || !pool || q->m_size > 0 || q->m_backend == ISRAELIQUEUE_ARRAY) {
+        return ISRAELIQUEUE_BAD_PARAM;
+    }
+
+    pool->m_references++;
+    NodePoolRelease(q->m_pool);
+    q->m_pool = pool;
+    return ISRAELIQUEUE_SUCCESS;
+}
+
+IsraeliQueuePairCache IsraeliQueuePairCacheCreate(void) {
+    IsraeliQueuePairCache cache = (IsraeliQueuePairCache)malloc(sizeof(struct IsraeliQueuePairCache_t));
+    if (!cache) {
+        return NULL;
+    }
+
+    cache->m_entries = NULL;
+    cache->m_capacity = 0;
+    cache->m_count = 0;
+    cache->m_friendships = NULL;
+    cache->m_friendshipsLength = 0;
+    cache->m_friendshipThreshold = 0;
+    cache->m_rivalryThreshold = 0;
+    cache->m_hits = 0;
+    cache->m_misses = 0;
+    cache->m_references = 1;
+    return cache;
+}
+
+void IsraeliQueuePairCacheDestroy(IsraeliQueuePairCache cache) {
+    PairCacheRelease(cache);
+}
+
+IsraeliQueueError IsraeliQueueSetPairCache(IsraeliQueue q, IsraeliQueuePairCache cache) {
+    if (!q) {
+        return ISRAELIQUEUE_BAD_PARAM;
+    }
+
+    if (cache) {
+        cache->m_references++;
+    }
+    PairCacheRelease(q->m_pairCache);
+    q->m_pairCache = cache;
+    return ISRAELIQUEUE_SUCCESS;
+}
+
+void IsraeliQueuePairCacheGetStats(IsraeliQueuePairCache cache, long long* hits, long long* misses) {
+    if (hits) {
+        *hits = cache ? cache->m_hits : 0;
+    }
+    if (misses) {
+        *misses = cache ? cache->m_misses : 0;
+    }
+}
+
+IsraeliQueueIngestBuffer IsraeliQueueIngestBufferCreate(IsraeliQueue q, int capacity) {
+    if (!q || capacity <= 0 || capacity > (1 << 30)) {
+        return NULL;
+    }
+
+    size_t cells = 1;
+    while (cells < (size_t)capacity) {
+        cells *= 2;
+    }
+
+    IsraeliQueueIngestBuffer buffer = (IsraeliQueueIngestBuffer)malloc(sizeof(struct IsraeliQueueIngestBuffer_t));
+    if (!buffer) {
+        return NULL;
+    }
+    buffer->m_cells = (IngestCell*)malloc(sizeof(IngestCell) * cells);
+    buffer->m_batch = (void**)malloc(sizeof(void*) * cells);
+    if (!buffer->m_cells || !buffer->m_batch) {
+        free(buffer->m_cells);
+        free(buffer->m_batch);
+        free(buffer);
+        return NULL;
+    }
+
+    for (size_t i = 0; i < cells; i++) {
+        buffer->m_cells[i].m_sequence = i;
+        buffer->m_cells[i].m_data = NULL;
+    }
+    buffer->m_queue = q;
+    buffer->m_mask = cells - 1;
+    buffer->m_tail = 0;
+    buffer->m_head = 0;
+    return buffer;
+}
+
+void IsraeliQueueIngestBufferDestroy(IsraeliQueueIngestBuffer buffer) {
+    if (!buffer) {
+        return;
+    }
+
+    free(buffer->m_cells);
+    free(buffer->m_batch);
+    free(buffer);
+}
+
+IsraeliQueueError IsraeliQueueIngestBufferPush(IsraeliQueueIngestBuffer buffer, void* data) {
+    if (!buffer) {
+        return ISRAELIQUEUE_BAD_PARAM;
+    }
+
+    size_t position = __atomic_load_n(&buffer->m_tail, __ATOMIC_RELAXED);
+    IngestCell* cell;
+    while (true) {
+        cell = &buffer->m_cells[position & buffer->m_mask];
+        size_t sequence = __atomic_load_n(&cell->m_sequence, __ATOMIC_ACQUIRE);
+        if (sequence == position) {
+            // The slot is free. Claim the position, or retry with whichever
+            // position another producer left in m_tail.
+            if (__atomic_compare_exchange_n(&buffer->m_tail, &position, position + 1, true,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if ((ptrdiff_t)(sequence - position) < 0) {
+            // The slot still holds the item pushed a full round ago.
+            return ISRAELI_QUEUE_ERROR;
+        } else {
+            position = __atomic_load_n(&buffer->m_tail, __ATOMIC_RELAXED);
+        }
+    }
+
+    cell->m_data = data;
+    __atomic_store_n(&cell->m_sequence, position + 1, __ATOMIC_RELEASE);
+    return ISRAELIQUEUE_SUCCESS;
+}
+
+IsraeliQueueError IsraeliQueueIngestBufferDrain(IsraeliQueueIngestBuffer buffer, int* drained) {
+    if (drained) {
+        *drained = 0;
+    }
+    if (!buffer) {
+        return ISRAELIQUEUE_BAD_PARAM;
+    }
+
+    // Take the items that are ready, up to the first slot a producer has
+    // claimed but not filled yet, so that arrival order is kept.
+    size_t head = buffer->m_head;
+    int count = 0;
+    while ((size_t)count <= buffer->m_mask) {
+        IngestCell* cell = &buffer->m_cells[(head + count) & buffer->m_mask];
+        if (__atomic_load_n(&cell->m_sequence, __ATOMIC_ACQUIRE) != head + count + 1) {
+            break;
+        }
+        buffer->m_batch[count++] = cell->m_data;
+    }
+    if (count == 0) {
+        return ISRAELIQUEUE_SUCCESS;
+    }
+
+    // The slots are only handed back once their items are in the queue, so
+    // nothing is lost if placing them fails.
+    IsraeliQueueError error = IsraeliQueueEnqueueMany(buffer->m_queue, buffer->m_batch, count);
+    if (error != ISRAELIQUEUE_SUCCESS) {
+        return error;
+    }
+    for (int i = 0; i < count; i++) {
+        IngestCell* cell = &buffer->m_cells[(head + i) & buffer->m_mask];
+        __atomic_store_n(&cell->m_sequence, head + i + buffer->m_mask + 1, __ATOMIC_RELEASE);
+    }
+    buffer->m_head = head + count;
+
+    if (drained) {
+        *drained = count;
+    }
+    return ISRAELIQUEUE_SUCCESS;
 }
 
 typedef struct MergeRet {
@@ -386,9 +2073,11 @@ IsraeliQueue IsraeliQueueMerge(IsraeliQueue* qarr, ComparisonFunction compare) {
 
     MergeRet results = MergeFriendshipsAndThresholds(qarr);
 
-    IsraeliQueue mergedQueue = IsraeliQueueCreate(
+    // The merged queue is stored the same way as the first queue.
+    IsraeliQueue mergedQueue = IsraeliQueueCreateWithBackend(
             results.friendshipFunctions, compare,
-            results.friendshipThreshold, results.rivalThreshold
+            results.friendshipThreshold, results.rivalThreshold,
+            qarr[0] ? qarr[0]->m_backend : ISRAELIQUEUE_LINKED_LIST
     );
 
     // The constructor copies the friendships array, so we can free it.
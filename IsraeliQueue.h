@@ -7,9 +7,27 @@
 #define RIVAL_QUOTA 3
 
 typedef struct IsraeliQueue_t * IsraeliQueue;
+typedef struct IsraeliQueueNodePool_t * IsraeliQueueNodePool;
+typedef struct IsraeliQueuePairCache_t * IsraeliQueuePairCache;
+typedef struct IsraeliQueueIngestBuffer_t * IsraeliQueueIngestBuffer;
 
 typedef int (*FriendshipFunction)(void*,void*);
 typedef int (*ComparisonFunction)(void*,void*);
+typedef int (*FriendshipScorer)(void*,void*,int,int);
+typedef bool (*IsraeliQueueVisitor)(void*,void*);
+
+typedef enum { ISRAELIQUEUE_LINKED_LIST, ISRAELIQUEUE_ARRAY } IsraeliQueueBackend;
+
+/**A position in an IsraeliQueue, for reading its elements in order without modifying it.
+ * Its fields are private to the queue. A cursor is invalidated by any change to the queue.*/
+typedef struct IsraeliQueueCursor {
+    IsraeliQueue m_queue;
+    void* m_node;
+    int m_physical;
+    int m_position;
+} IsraeliQueueCursor;
+
+typedef enum { ISRAELIQUEUE_ORDER_REGISTRATION, ISRAELIQUEUE_ORDER_COST, ISRAELIQUEUE_ORDER_DECISIVE } IsraeliQueueMeasureOrder;
 
 typedef enum { ISRAELIQUEUE_SUCCESS, ISRAELIQUEUE_ALLOC_FAILED, ISRAELIQUEUE_BAD_PARAM, ISRAELI_QUEUE_ERROR } IsraeliQueueError;
 
@@ -25,10 +43,33 @@ typedef enum { ISRAELIQUEUE_SUCCESS, ISRAELIQUEUE_ALLOC_FAILED, ISRAELIQUEUE_BAD
  * to the new object. In case of failure, return NULL.*/
 IsraeliQueue IsraeliQueueCreate(FriendshipFunction *, ComparisonFunction, int, int);
 
+/**Same as IsraeliQueueCreate, with the way the queue is stored chosen by the last parameter.
+ * ISRAELIQUEUE_LINKED_LIST is what IsraeliQueueCreate uses. ISRAELIQUEUE_ARRAY keeps the
+ * items and their counters in contiguous arrays, which makes every placement scan cheaper,
+ * at the cost of moving elements when inserting in the middle of the queue.*/
+IsraeliQueue IsraeliQueueCreateWithBackend(FriendshipFunction *, ComparisonFunction, int, int, IsraeliQueueBackend);
+
+/**Same as IsraeliQueueCreate, for a queue that several threads use at once. IsraeliQueueEnqueue,
+ * IsraeliQueueEnqueueMany, IsraeliQueueDequeue and IsraeliQueueSize may be called from any number
+ * of threads concurrently. Enqueues and dequeues are carried out one at a time, in the order they
+ * were called, by whichever waiting thread gets the queue's lock, so every element is placed by the
+ * usual friend and rival rules. IsraeliQueueSize does not lock. Every other function must not run
+ * concurrently with any function on the same queue.*/
+IsraeliQueue IsraeliQueueCreateConcurrent(FriendshipFunction *, ComparisonFunction, int, int);
+
 /**Returns a new queue with the same elements as the parameter. If the parameter is NULL or any error occured during
  * the execution of the function, NULL is returned.*/
 IsraeliQueue IsraeliQueueClone(IsraeliQueue q);
 
+/**Returns a new queue with the same elements as the parameter, like IsraeliQueueClone, in constant
+ * time for array backed queues only. Such a queue and its snapshot share their elements until either
+ * of them inserts, places or moves elements, at which point that queue copies all of its elements, not
+ * only the ones it changes. Dequeuing does not copy. For linked list backed queues, the default, this
+ * is exactly IsraeliQueueClone, in time and memory linear in their size. Taking a snapshot of an array
+ * backed queue modifies it, and a queue and its snapshots must not be used by several threads at once.
+ * If the parameter is NULL or any error occured, NULL is returned.*/
+IsraeliQueue IsraeliQueueSnapshot(IsraeliQueue q);
+
 /**@param IsraeliQueue: an IsraeliQueue created by IsraeliQueueCreate
  *
  * Deallocates all memory allocated by IsraeliQueueCreate for the object pointed to by
@@ -41,6 +82,16 @@ void IsraeliQueueDestroy(IsraeliQueue);
  * Places the item in the foremost position accessible to it.*/
 IsraeliQueueError IsraeliQueueEnqueue(IsraeliQueue, void *);
 
+/**@param IsraeliQueue: an IsraeliQueue in which to insert the items.
+ * @param items: an array of items to enqueue
+ * @param n: the number of items in the array
+ *
+ * Places the items one after the other, exactly like n calls to IsraeliQueueEnqueue would.
+ * The memory for all the items is allocated before any of them is placed, so in case of
+ * failure none of them is inserted. If an item appears more than once in the batch, the
+ * friendship statuses are computed once for the whole batch, as with a pair cache.*/
+IsraeliQueueError IsraeliQueueEnqueueMany(IsraeliQueue, void **, int);
+
 /**@param IsraeliQueue: an IsraeliQueue to which the function is to be added
  * @param FriendshipFunction: a FriendshipFunction to be recognized by the IsraeliQueue
  * going forward.
@@ -48,6 +99,52 @@ IsraeliQueueError IsraeliQueueEnqueue(IsraeliQueue, void *);
  * Makes the IsraeliQueue provided recognize the FriendshipFunction provided.*/
 IsraeliQueueError IsraeliQueueAddFriendshipMeasure(IsraeliQueue, FriendshipFunction);
 
+/**@param IsraeliQueue: an IsraeliQueue
+ * @param FriendshipScorer: a function that decides what the queue's friendship measures decide, or NULL
+ *
+ * Makes the queue score each pair of items with a single call to the scorer instead of calling its
+ * friendship measures one by one. The scorer is given the two items and the queue's friendship and
+ * rivalry thresholds, and returns a positive value if the items are friends, a negative value if they
+ * are rivals and 0 otherwise. It must decide exactly like the measures would, summing them in order and
+ * stopping once the sum exceeds the friendship threshold. Adding a friendship measure drops the scorer,
+ * and clones keep it. If the queue is NULL, ISRAELIQUEUE_BAD_PARAM is returned.*/
+IsraeliQueueError IsraeliQueueSetFriendshipScorer(IsraeliQueue, FriendshipScorer);
+
+/**@param IsraeliQueue: an IsraeliQueue
+ * @param IsraeliQueueMeasureOrder: the order in which the friendship measures are to be called
+ *
+ * ISRAELIQUEUE_ORDER_REGISTRATION calls the measures in the order they were added, which is the default.
+ * ISRAELIQUEUE_ORDER_COST calls the cheapest measures first, by their measured time per call, and
+ * ISRAELIQUEUE_ORDER_DECISIVE calls first the measures that most often decide a pair are friends. The
+ * order is updated periodically from the statistics the queue collects while it is not the default.
+ * The result is the same in any order: a pair is only decided before all the measures are called once
+ * the lower bounds of the measures left (see IsraeliQueueSetMeasureLowerBound) show it exceeds the
+ * friendship threshold, so measures without a lower bound are always called. The measures must not
+ * have side effects. A scorer set by IsraeliQueueSetFriendshipScorer takes precedence over the measures.
+ * If the queue is NULL, ISRAELIQUEUE_BAD_PARAM is returned.*/
+IsraeliQueueError IsraeliQueueSetMeasureOrder(IsraeliQueue, IsraeliQueueMeasureOrder);
+
+/**@param IsraeliQueue: an IsraeliQueue
+ * @param FriendshipFunction: a friendship measure of the queue
+ * @param lowerBound: a value the measure never returns less than
+ *
+ * Lets the queue decide a pair are friends without calling the measure, when the measures called so
+ * far together with the lower bounds of the others exceed the friendship threshold. Clones keep the
+ * bounds. If the queue is NULL or the function is not one of its measures, ISRAELIQUEUE_BAD_PARAM is
+ * returned.*/
+IsraeliQueueError IsraeliQueueSetMeasureLowerBound(IsraeliQueue, FriendshipFunction, int lowerBound);
+
+/**@param IsraeliQueue: an IsraeliQueue
+ * @param index: the index of a friendship measure, in the order the measures were added
+ *
+ * Writes the number of times the measure was called, the number of pairs it decided as friends by
+ * ending the scoring early, its average time per call in nanoseconds (measured on a sample of the
+ * calls) and its current position in the order the measures are called. Statistics are only collected
+ * while the measure order is not ISRAELIQUEUE_ORDER_REGISTRATION. Any of the pointers may be NULL.
+ * If the queue is NULL or the index is out of range, ISRAELIQUEUE_BAD_PARAM is returned.*/
+IsraeliQueueError IsraeliQueueGetMeasureStats(IsraeliQueue, int index, long long* calls, long long* exits,
+                                              double* nanosecondsPerCall, int* position);
+
 /**@param IsraeliQueue: an IsraeliQueue whose friendship threshold is to be modified
  * @param friendship_threshold: a new friendship threshold for the IsraeliQueue*/
 IsraeliQueueError IsraeliQueueUpdateFriendshipThreshold(IsraeliQueue, int);
@@ -70,6 +167,57 @@ void* IsraeliQueueDequeue(IsraeliQueue);
  * parameter is NULL, false is returned.*/
 bool IsraeliQueueContains(IsraeliQueue, void *);
 
+/**@param item: an object comparable to the objects in the IsraeliQueue
+ *
+ * Returns the position of the foremost element equal to item, 0 being the head of the queue,
+ * or -1 if there is none or either parameter is NULL. Elements are compared with the queue's
+ * comparison function, or by address if it has none. The queue is not modified.*/
+int IsraeliQueuePositionOf(IsraeliQueue, void *);
+
+/**@param item: an object comparable to the objects in the IsraeliQueue
+ * @param k: the number of elements from the head of the queue to look at
+ *
+ * Returns whether one of the first k elements of the queue is equal to item, comparing like
+ * IsraeliQueuePositionOf. Only those elements are visited, and the queue is not modified.*/
+bool IsraeliQueueIsWithinFirst(IsraeliQueue, void *, int k);
+
+/**Reading functions:
+ * IsraeliQueueBegin, IsraeliQueueCursorPeek, IsraeliQueueCursorNext, IsraeliQueuePeekAt,
+ * IsraeliQueueToArray, IsraeliQueueForEach, IsraeliQueuePositionOf, IsraeliQueueIsWithinFirst and
+ * IsraeliQueueSize neither modify the queue nor allocate memory, so any number of threads may call
+ * them on the same queue at once, as long as no thread modifies it meanwhile.*/
+
+/**Returns a cursor at the head of the queue. If the queue is NULL, the cursor is at its end.*/
+IsraeliQueueCursor IsraeliQueueBegin(IsraeliQueue);
+
+/**Returns the element at the cursor, or NULL if the cursor is at the end of the queue.*/
+void* IsraeliQueueCursorPeek(const IsraeliQueueCursor*);
+
+/**Returns the element at the cursor and moves the cursor to the next one, or returns NULL if the
+ * cursor is at the end of the queue.*/
+void* IsraeliQueueCursorNext(IsraeliQueueCursor*);
+
+/**Returns the element at the given position, 0 being the head of the queue, or NULL if the queue
+ * is NULL or the position is out of range. Takes time proportional to the position for linked
+ * list backed queues, and constant time for array backed ones.*/
+void* IsraeliQueuePeekAt(IsraeliQueue, int index);
+
+/**@param buffer: an array of at least capacity elements
+ * @param capacity: the number of elements the buffer can hold
+ *
+ * Copies the first elements of the queue, up to capacity of them, to the buffer in order, and
+ * returns the number of elements copied. If the queue or buffer is NULL, 0 is returned.*/
+int IsraeliQueueToArray(IsraeliQueue, void** buffer, int capacity);
+
+/**@param IsraeliQueue: an IsraeliQueue to go over
+ * @param IsraeliQueueVisitor: a function to call with each element and the context
+ * @param context: the second parameter of every call to the visitor
+ *
+ * Calls the visitor with the elements of the queue, from its head to its tail, until the visitor
+ * returns false. The queue is not modified, and the visitor must not modify it either. If the queue
+ * or the visitor is NULL, ISRAELIQUEUE_BAD_PARAM is returned.*/
+IsraeliQueueError IsraeliQueueForEach(IsraeliQueue, IsraeliQueueVisitor, void* context);
+
 /**Advances each item in the queue to the foremost position accessible to it,
  * from the back of the queue frontwards.*/
 IsraeliQueueError IsraeliQueueImprovePositions(IsraeliQueue);
@@ -82,4 +230,69 @@ IsraeliQueueError IsraeliQueueImprovePositions(IsraeliQueue);
  * one enqueue an item, in the order defined by q_arr. In the event of any error during execution, return NULL.*/
 IsraeliQueue IsraeliQueueMerge(IsraeliQueue*,ComparisonFunction);
 
+/**Creates a pool from which several queues can allocate their nodes. Nodes are allocated
+ * in slabs and reused through a free list. Returns NULL in case of failure.*/
+IsraeliQueueNodePool IsraeliQueueNodePoolCreate(void);
+
+/**Releases the caller's reference to the pool. Its memory is freed once every queue
+ * using it has been destroyed as well.*/
+void IsraeliQueueNodePoolDestroy(IsraeliQueueNodePool);
+
+/**@param IsraeliQueue: an empty IsraeliQueue
+ * @param IsraeliQueueNodePool: the pool the queue is to allocate its nodes from
+ *
+ * Makes the queue, and any queue cloned from it, allocate nodes from the given pool instead
+ * of a private one. If either parameter is NULL, the queue is not empty or it is array backed, and
+ * so has no nodes, ISRAELIQUEUE_BAD_PARAM is returned.*/
+IsraeliQueueError IsraeliQueueSetNodePool(IsraeliQueue, IsraeliQueueNodePool);
+
+/**Creates a cache of the friendship status of pairs of items, which queues with the same
+ * friendship functions and thresholds can share. Returns NULL in case of failure.*/
+IsraeliQueuePairCache IsraeliQueuePairCacheCreate(void);
+
+/**Releases the caller's reference to the cache. Its memory is freed once every queue
+ * using it has been destroyed or detached from it as well.*/
+void IsraeliQueuePairCacheDestroy(IsraeliQueuePairCache);
+
+/**@param IsraeliQueue: an IsraeliQueue
+ * @param IsraeliQueuePairCache: the cache the queue is to use, or NULL to stop using one
+ *
+ * Makes the queue, and any queue cloned from it, remember the friendship status of every pair
+ * of items it compares in the given cache, instead of calling its friendship functions again for
+ * the same pair. The friendship functions must return the same value whenever they are called with
+ * the same pair. The cache is emptied whenever it is used by a queue whose friendship functions or
+ * thresholds differ from the ones it was filled with, such as after IsraeliQueueAddFriendshipMeasure
+ * or a threshold update. If the queue is NULL, ISRAELIQUEUE_BAD_PARAM is returned.*/
+IsraeliQueueError IsraeliQueueSetPairCache(IsraeliQueue, IsraeliQueuePairCache);
+
+/**Writes the number of friendship lookups the cache answered to hits, and the number of lookups
+ * it could not answer to misses. Either pointer may be NULL.*/
+void IsraeliQueuePairCacheGetStats(IsraeliQueuePairCache, long long* hits, long long* misses);
+
+/**Creates a buffer in front of the given queue, holding up to capacity items (rounded up to a
+ * power of two) that were pushed but not yet drained into the queue. Any number of threads may
+ * push into the buffer at once, without locking and without waiting for items to be placed, while
+ * a single thread drains it. Returns NULL if the queue is NULL, capacity is not positive or an
+ * allocation failed.*/
+IsraeliQueueIngestBuffer IsraeliQueueIngestBufferCreate(IsraeliQueue, int capacity);
+
+/**Frees the buffer. Items that were pushed but not drained are dropped; the queue is not affected.*/
+void IsraeliQueueIngestBufferDestroy(IsraeliQueueIngestBuffer);
+
+/**Adds an item to the buffer, to be enqueued by the next drain. May be called from any number of
+ * threads concurrently with each other and with IsraeliQueueIngestBufferDrain. Returns
+ * ISRAELI_QUEUE_ERROR if the buffer is full, in which case the caller may retry once it has been
+ * drained, and ISRAELIQUEUE_BAD_PARAM if the buffer is NULL.*/
+IsraeliQueueError IsraeliQueueIngestBufferPush(IsraeliQueueIngestBuffer, void*);
+
+/**@param IsraeliQueueIngestBuffer: the buffer to drain
+ * @param drained: where to write the number of items enqueued, or NULL
+ *
+ * Enqueues the items pushed into the buffer so far, in the order they were pushed, with
+ * IsraeliQueueEnqueueMany. Stops at an item whose push has not completed yet, so a later call picks
+ * it and everything after it up. Only one thread may drain a buffer, and the queue must not be used
+ * by any other thread meanwhile unless it was created by IsraeliQueueCreateConcurrent. If placing
+ * the items fails, the error is returned and they stay in the buffer.*/
+IsraeliQueueError IsraeliQueueIngestBufferDrain(IsraeliQueueIngestBuffer, int* drained);
+
 #endif //PROVIDED_ISRAELIQUEUE_H
@@ -0,0 +1,244 @@
+#!/bin/bash
+
+# Times HackEnrollment on generated inputs of growing size.
+# Usage: ./bench.sh [scenario] [extra HackEnrollment flags]
+#   queue: a single course whose queue length doubles each run.
+#   nodes: 10^5 to 10^6 element queues over a few students, dominated by node
+#          allocation in enqueue, clone and dequeue.
+#   scan:  a single course with many hackers, dominated by placement scans.
+#          Compare with '-a' for array backed queues.
+#   jobs:  thousands of courses, processed with a growing number of threads.
+#   courses: growing course catalogs with short queues, dominated by loading and
+#          resolving course numbers.
+#   parse: a large students file, reporting parse throughput. Its size in MB is
+#          PARSE_MB, 1024 by default.
+#   friends: hackers with thousands of friends each, dominated by friend and
+#          rival lookups.
+#   pairs: one long queue that thousands of hackers are placed in, reporting the
+#          cost per pair of students scored, about hackers * (queue + hackers / 2).
+#   case:  the pairs queue, placed case sensitively and with '-i'.
+#   scorer: the pairs queue, scored by the fused scorer and with '-g' through each
+#          friendship function, reporting the cost per pair for both.
+#   verify: 10^4 hackers with two courses each, over 100 courses with long queues,
+#          dominated by checking which hackers made it into their courses.
+#   output: 10^7 students in the queues of 1000 courses and no hackers, dominated
+#          by reading the queues and printing them.
+#   many:  2*10^6 items enqueued into queues of both backends without friendship
+#          measures, and 5000 with one, one at a time (batch 0) and with
+#          IsraeliQueueEnqueueMany in batches of 1 to 4096, reporting items/s.
+#   snapshot: 1000 copies of a 10^5 element array backed queue, taken with
+#          IsraeliQueueClone and with IsraeliQueueSnapshot, then dequeued from and
+#          enqueued into, reporting seconds and extra peak memory in MB.
+#   concurrent: 1 to 32 threads enqueuing into and dequeuing from one shared
+#          queue, behind a single mutex and with IsraeliQueueCreateConcurrent,
+#          reporting operations per second.
+#   ingest: 1 to 32 threads enqueuing 2*10^4 elements, directly into a concurrent
+#          queue and through an ingest buffer drained by one thread, reporting
+#          elements placed per second and percentiles of the time a single
+#          enqueue or push took, in ns.
+#   order: the pairs queue, with the friendship functions called in the order
+#          they were added ('-g') and reordered by cost and by decisiveness ('-o').
+#   load:  a large students file, loaded by reading and by mapping it ('-m'),
+#          reporting time and peak resident memory. Its size is PARSE_MB as well.
+
+BIN=${BIN:-./HackEnrollment}
+TMP=$(mktemp -d)
+TIMEFORMAT=%R
+scenario=${1:-queue}
+shift
+
+# Writes students, courses, queues and hackers files to the given directory.
+# Usage: generate <dir> <students> <courses> <queue length> <hackers> [friends]
+generate() {
+   awk -v dir="$1" -v S="$2" -v C="$3" -v Q="$4" -v H="$5" -v F="${6:-3}" 'BEGIN {
+      srand(1)
+      split("Dan Dana Avi Aviv Noa Ron Rona Eli Yael Yaela", names, " ")
+      for (i = 0; i < S; i++) {
+         printf "%d %d %d %s %s Haifa CS\n", 100000000 + i * 37, i % 200, 60 + i % 40,
+            names[1 + int(rand() * 10)], names[1 + int(rand() * 10)] > dir "/students.txt"
+      }
+      for (c = 0; c < C; c++) {
+         printf "%d %d\n", 100000 + c, Q + H > dir "/courses.txt"
+         printf "%d", 100000 + c > dir "/queues.txt"
+         for (j = 0; j < Q; j++) {
+            printf " %d", 100000000 + ((c * Q + j) % S) * 37 > dir "/queues.txt"
+         }
+         printf "\n" > dir "/queues.txt"
+      }
+      for (h = 0; h < H; h++) {
+         hacker = int(h * S / H)
+         printf "%d\n%d", 100000000 + hacker * 37, 100000 + h % C > dir "/hackers.txt"
+         if (C > 1) {
+            printf " %d", 100000 + (h + 1) % C > dir "/hackers.txt"
+         }
+         printf "\n" > dir "/hackers.txt"
+         for (f = 0; f < F; f++) {
+            printf "%s%d", f ? " " : "", 100000000 + int(rand() * S) * 37 > dir "/hackers.txt"
+         }
+         printf "\n" > dir "/hackers.txt"
+         printf "%d %d\n", 100000000 + int(rand() * S) * 37, 100000000 + int(rand() * S) * 37 > dir "/hackers.txt"
+      }
+   }'
+}
+
+# Runs HackEnrollment on a generated directory and prints the elapsed seconds.
+# Usage: run <dir> [flags]
+run() {
+   local dir=$1
+   shift
+   { time $BIN "$@" $dir/students.txt $dir/courses.txt $dir/hackers.txt $dir/queues.txt $dir/out.txt > /dev/null; } 2>&1
+}
+
+# Like run, but prints the elapsed seconds and the peak resident memory in MB,
+# sampled from /proc while HackEnrollment runs.
+run_memory() {
+   local dir=$1
+   local start=$(date +%s.%N)
+   local peak=0
+   shift
+   $BIN "$@" $dir/students.txt $dir/courses.txt $dir/hackers.txt $dir/queues.txt $dir/out.txt > /dev/null &
+   local pid=$!
+   while kill -0 $pid 2> /dev/null; do
+      peak=$(awk -v peak=$peak '/VmHWM/ { peak = $2 } END { print peak }' /proc/$pid/status 2> /dev/null)
+      sleep 0.05
+   done
+   wait $pid
+   awk -v start=$start -v end=$(date +%s.%N) -v peak=$peak \
+      'BEGIN { printf "%.3f\t%.0f\n", end - start, peak / 1024 }'
+}
+
+case $scenario in
+   queue)
+      echo -e "queue length\tseconds"
+      for n in 1000 2000 4000 8000 16000 32000; do
+         rm -f $TMP/*
+         generate $TMP $n 1 $n $((n / 100))
+         echo -e "$n\t$(run $TMP "$@")"
+      done
+      ;;
+   nodes)
+      echo -e "queue length\tseconds"
+      for n in 100000 200000 500000 1000000; do
+         rm -f $TMP/*
+         generate $TMP 10 1 $n 1
+         echo -e "$n\t$(run $TMP "$@")"
+      done
+      ;;
+   scan)
+      echo -e "hackers\tseconds"
+      for n in 500 1000 2000 4000; do
+         rm -f $TMP/*
+         generate $TMP $((n * 2)) 1 $((n * 2)) $n
+         echo -e "$n\t$(run $TMP "$@")"
+      done
+      ;;
+   jobs)
+      generate $TMP 4000 2000 200 2000
+      echo -e "threads\tseconds"
+      for j in 1 2 4 8; do
+         echo -e "$j\t$(run $TMP -j $j "$@")"
+      done
+      ;;
+   courses)
+      echo -e "courses\tseconds"
+      for n in 10000 20000 40000 80000; do
+         rm -f $TMP/*
+         generate $TMP 1000 $n 2 $n
+         echo -e "$n\t$(run $TMP "$@")"
+      done
+      ;;
+   parse)
+      # Student lines average about 36 bytes.
+      generate $TMP $(( ${PARSE_MB:-1024} * 1048576 / 36 )) 1 1 1
+      bytes=$(wc -c < $TMP/students.txt)
+      seconds=$(run $TMP "$@")
+      echo -e "MB\tseconds\tMB/s"
+      awk -v b=$bytes -v s=$seconds 'BEGIN { printf "%.0f\t%s\t%.1f\n", b / 1048576, s, b / 1048576 / s }'
+      ;;
+   friends)
+      echo -e "friends\tseconds"
+      for n in 100 1000 2000 4000; do
+         rm -f $TMP/*
+         generate $TMP 8000 1 1000 500 $n
+         echo -e "$n\t$(run $TMP "$@")"
+      done
+      ;;
+   pairs)
+      generate $TMP 8000 1 8000 4000
+      seconds=$(run $TMP "$@")
+      echo -e "pairs\tseconds\tns/pair"
+      awk -v s=$seconds 'BEGIN { p = 4000 * (8000 + 4000 / 2); printf "%d\t%s\t%.1f\n", p, s, s * 1e9 / p }'
+      ;;
+   verify)
+      generate $TMP 20000 100 5000 10000
+      echo -e "hackers\tseconds"
+      echo -e "10000\t$(run $TMP "$@")"
+      ;;
+   output)
+      generate $TMP 100000 1000 10000 0
+      touch $TMP/hackers.txt
+      echo -e "ids\tseconds"
+      echo -e "10000000\t$(run $TMP "$@")"
+      ;;
+   many)
+      gcc -O2 -std=c99 -pthread -I. -Wall -pedantic-errors -Werror -DNDEBUG \
+         tests/enqueueManyBench.c IsraeliQueue.c -lm -o $TMP/enqueueManyBench || exit 1
+      echo -e "measures\tbackend\tbatch\titems/s"
+      $TMP/enqueueManyBench "$@"
+      ;;
+   snapshot)
+      gcc -O2 -std=c99 -pthread -I. -Wall -pedantic-errors -Werror -DNDEBUG \
+         tests/snapshotBench.c IsraeliQueue.c -lm -o $TMP/snapshotBench || exit 1
+      echo -e "copies\tseconds\tMB\tmutate\tMB"
+      $TMP/snapshotBench clone "$@"
+      $TMP/snapshotBench snapshot "$@"
+      ;;
+   concurrent)
+      gcc -O2 -std=c99 -pthread -I. -Wall -pedantic-errors -Werror -DNDEBUG \
+         tests/concurrentBench.c IsraeliQueue.c -lm -o $TMP/concurrentBench || exit 1
+      echo -e "queue\tthreads\tops/s\tsize"
+      $TMP/concurrentBench mutex "$@"
+      $TMP/concurrentBench combining "$@"
+      ;;
+   ingest)
+      gcc -O2 -std=c99 -pthread -I. -Wall -pedantic-errors -Werror -DNDEBUG \
+         tests/ingestBench.c IsraeliQueue.c -lm -o $TMP/ingestBench || exit 1
+      echo -e "enqueue\tthreads\tplaced/s\tp50\tp99\tp99.9\tmax\tsize"
+      $TMP/ingestBench direct "$@"
+      $TMP/ingestBench ingest "$@"
+      ;;
+   order)
+      generate $TMP 8000 1 8000 4000
+      echo -e "flags\tseconds\tns/pair"
+      for flags in "-g" "-o cost" "-o decisive"; do
+         seconds=$(run $TMP $flags "$@")
+         awk -v f="$flags" -v s=$seconds 'BEGIN { p = 4000 * (8000 + 4000 / 2); printf "%s\t%s\t%.1f\n", f, s, s * 1e9 / p }'
+      done
+      ;;
+   scorer)
+      generate $TMP 8000 1 8000 4000
+      echo -e "flags\tseconds\tns/pair"
+      for flags in "" "-g"; do
+         seconds=$(run $TMP $flags "$@")
+         awk -v f="${flags:--}" -v s=$seconds 'BEGIN { p = 4000 * (8000 + 4000 / 2); printf "%s\t%s\t%.1f\n", f, s, s * 1e9 / p }'
+      done
+      ;;
+   case)
+      generate $TMP 8000 1 8000 4000
+      echo -e "flags\tseconds"
+      for flags in "" "-i"; do
+         echo -e "${flags:--}\t$(run $TMP $flags "$@")"
+      done
+      ;;
+   load)
+      generate $TMP $(( ${PARSE_MB:-1024} * 1048576 / 36 )) 1 1 1
+      echo -e "loader\tseconds\tpeak MB"
+      echo -e "read\t$(run_memory $TMP "$@")"
+      echo -e "mapped\t$(run_memory $TMP -m "$@")"
+      ;;
+   *)
+      echo "Unknown scenario: $scenario"
+      ;;
+esac
+
+rm -r $TMP
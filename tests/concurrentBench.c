@@ -0,0 +1,103 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "IsraeliQueue.h"
+
+// Runs threads that each enqueue an element and dequeue one, over and over,
+// on one shared queue: either a queue made by IsraeliQueueCreate behind a
+// single mutex, or a queue made by IsraeliQueueCreateConcurrent. Reports the
+// operations per second for every thread count.
+// Usage: concurrentBench <mutex|combining> [operations per thread] [queue size]
+
+#define DEFAULT_OPERATIONS 20000
+#define DEFAULT_QUEUE_SIZE 1000
+#define MAX_THREADS 32
+
+typedef struct {
+    IsraeliQueue m_queue;
+    pthread_mutex_t* m_lock;
+    int* m_items;
+    int m_operations;
+} Worker;
+
+double now(void) {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+int sameTens(void* first, void* second) {
+    return *(int*)first / 10 == *(int*)second / 10 ? 20 : 0;
+}
+
+void* work(void* argument) {
+    Worker* worker = argument;
+    for (int i = 0; i < worker->m_operations; i++) {
+        void* item = &worker->m_items[i % 100];
+        if (worker->m_lock) {
+            pthread_mutex_lock(worker->m_lock);
+            IsraeliQueueEnqueue(worker->m_queue, item);
+            IsraeliQueueDequeue(worker->m_queue);
+            pthread_mutex_unlock(worker->m_lock);
+        } else {
+            IsraeliQueueEnqueue(worker->m_queue, item);
+            IsraeliQueueDequeue(worker->m_queue);
+        }
+    }
+    return NULL;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2 || (strcmp(argv[1], "mutex") != 0 && strcmp(argv[1], "combining") != 0)) {
+        printf("Usage: %s <mutex|combining> [operations per thread] [queue size]\n", argv[0]);
+        return 1;
+    }
+    bool combining = strcmp(argv[1], "combining") == 0;
+    int operations = argc > 2 ? atoi(argv[2]) : DEFAULT_OPERATIONS;
+    int size = argc > 3 ? atoi(argv[3]) : DEFAULT_QUEUE_SIZE;
+
+    int items[MAX_THREADS][100];
+    for (int i = 0; i < MAX_THREADS; i++) {
+        for (int j = 0; j < 100; j++) {
+            items[i][j] = i * 100 + j;
+        }
+    }
+
+    for (int threads = 1; threads <= MAX_THREADS; threads *= 2) {
+        FriendshipFunction friendships[2] = { sameTens, NULL };
+        IsraeliQueue queue = combining ? IsraeliQueueCreateConcurrent(friendships, NULL, 10, 5)
+                                       : IsraeliQueueCreate(friendships, NULL, 10, 5);
+        if (!queue) {
+            return 1;
+        }
+        for (int i = 0; i < size; i++) {
+            IsraeliQueueEnqueue(queue, &items[i % MAX_THREADS][i % 100]);
+        }
+
+        pthread_mutex_t lock;
+        pthread_mutex_init(&lock, NULL);
+        Worker workers[MAX_THREADS];
+        pthread_t ids[MAX_THREADS];
+        double start = now();
+        for (int i = 0; i < threads; i++) {
+            workers[i] = (Worker){ queue, combining ? NULL : &lock, items[i], operations };
+            if (pthread_create(&ids[i], NULL, work, &workers[i]) != 0) {
+                return 1;
+            }
+        }
+        for (int i = 0; i < threads; i++) {
+            pthread_join(ids[i], NULL);
+        }
+        double seconds = now() - start;
+
+        printf("%s\t%d\t%.0f\t%d\n", argv[1], threads, 2.0 * operations * threads / seconds, IsraeliQueueSize(queue));
+        pthread_mutex_destroy(&lock);
+        IsraeliQueueDestroy(queue);
+    }
+    return 0;
+}
@@ -0,0 +1,173 @@
+// Checks queues made by IsraeliQueueCreateConcurrent. Threads enqueue their own
+// items, alone or in batches, each followed by as many dequeues, and every item
+// must be dequeued exactly once, with no dequeue finding the queue empty. Then a
+// single thread runs a random sequence of enqueues, batches and dequeues on a
+// concurrent queue and on a plain one, which must dequeue the same items and
+// end up in the same order.
+// Usage: concurrentTest [threads]
+
+#include "IsraeliQueue.c"
+
+#define DEFAULT_THREADS 8
+#define MAX_THREADS 64
+#define ITEMS_PER_THREAD 1500
+#define MAX_BATCH 5
+#define SEQUENCE_LENGTH 20000
+#define YIELD_PERIOD 16
+
+int items[MAX_THREADS * ITEMS_PER_THREAD];
+int dequeued[MAX_THREADS * ITEMS_PER_THREAD];
+
+typedef struct Worker {
+    IsraeliQueue m_queue;
+    int m_first;
+    int m_emptyDequeues;
+} Worker;
+
+long long measureCalls = 0;
+
+// Gives up the processor now and then, in the middle of placing an item, so
+// other threads run while the queue is being changed even on a single core.
+int sameTens(void* first, void* second) {
+    if (__atomic_add_fetch(&measureCalls, 1, __ATOMIC_RELAXED) % YIELD_PERIOD == 0) {
+        sched_yield();
+    }
+    return *(int*)first / 10 == *(int*)second / 10 ? 20 : 0;
+}
+
+// Counts an item as dequeued, so a repeated item shows as a count of 2 or more.
+void countDequeued(void* item) {
+    __atomic_fetch_add(&dequeued[(int*)item - items], 1, __ATOMIC_RELAXED);
+}
+
+void* work(void* argument) {
+    Worker* worker = argument;
+    for (int i = 0; i < ITEMS_PER_THREAD;) {
+        // Every third round enqueues a batch.
+        int n = i % 3 == 2 ? 1 + i % MAX_BATCH : 1;
+        n = n < ITEMS_PER_THREAD - i ? n : ITEMS_PER_THREAD - i;
+        void* batch[MAX_BATCH];
+        for (int j = 0; j < n; j++) {
+            batch[j] = &items[worker->m_first + i + j];
+        }
+
+        if (n == 1) {
+            IsraeliQueueEnqueue(worker->m_queue, batch[0]);
+        } else {
+            IsraeliQueueEnqueueMany(worker->m_queue, batch, n);
+        }
+        for (int j = 0; j < n; j++) {
+            void* item = IsraeliQueueDequeue(worker->m_queue);
+            if (item) {
+                countDequeued(item);
+            } else {
+                worker->m_emptyDequeues++;
+            }
+        }
+        i += n;
+    }
+    return NULL;
+}
+
+bool testThreads(int threads) {
+    FriendshipFunction friendships[2] = { sameTens, NULL };
+    IsraeliQueue q = IsraeliQueueCreateConcurrent(friendships, NULL, 10, 0);
+    if (!q) {
+        return false;
+    }
+
+    Worker workers[MAX_THREADS];
+    pthread_t ids[MAX_THREADS];
+    for (int t = 0; t < threads; t++) {
+        Worker worker = { q, t * ITEMS_PER_THREAD, 0 };
+        workers[t] = worker;
+        if (pthread_create(&ids[t], NULL, work, &workers[t]) != 0) {
+            printf("Could not start thread %d\n", t);
+            return false;
+        }
+    }
+
+    bool passed = true;
+    for (int t = 0; t < threads; t++) {
+        pthread_join(ids[t], NULL);
+        if (workers[t].m_emptyDequeues > 0) {
+            printf("Thread %d found the queue empty %d times\n", t, workers[t].m_emptyDequeues);
+            passed = false;
+        }
+    }
+
+    if (IsraeliQueueSize(q) != 0 || IsraeliQueueDequeue(q)) {
+        printf("%d items were left in the queue\n", IsraeliQueueSize(q));
+        passed = false;
+    }
+    for (int i = 0; i < threads * ITEMS_PER_THREAD; i++) {
+        if (dequeued[i] != 1) {
+            printf("Item %d was dequeued %d times\n", i, dequeued[i]);
+            passed = false;
+        }
+    }
+
+    IsraeliQueueDestroy(q);
+    return passed;
+}
+
+bool testSequence(void) {
+    FriendshipFunction friendships[2] = { sameTens, NULL };
+    IsraeliQueue concurrent = IsraeliQueueCreateConcurrent(friendships, NULL, 10, 0);
+    IsraeliQueue plain = IsraeliQueueCreate(friendships, NULL, 10, 0);
+    if (!concurrent || !plain) {
+        return false;
+    }
+
+    bool passed = true;
+    for (int step = 0; step < SEQUENCE_LENGTH && passed; step++) {
+        // Dequeue half of the time, so the queues stay short.
+        int operation = rand() % 4;
+        if (operation == 0) {
+            void* item = &items[rand() % ITEMS_PER_THREAD];
+            IsraeliQueueEnqueue(concurrent, item);
+            IsraeliQueueEnqueue(plain, item);
+        } else if (operation == 1) {
+            void* batch[MAX_BATCH];
+            int n = rand() % (MAX_BATCH + 1);
+            for (int j = 0; j < n; j++) {
+                batch[j] = &items[rand() % ITEMS_PER_THREAD];
+            }
+            IsraeliQueueEnqueueMany(concurrent, batch, n);
+            IsraeliQueueEnqueueMany(plain, batch, n);
+        } else if (IsraeliQueueDequeue(concurrent) != IsraeliQueueDequeue(plain)) {
+            printf("Step %d: the queues dequeued different items\n", step);
+            passed = false;
+        }
+    }
+
+    int size = IsraeliQueueSize(plain);
+    void** concurrentItems = malloc(sizeof(void*) * (size + 1));
+    void** plainItems = malloc(sizeof(void*) * (size + 1));
+    if (!concurrentItems || !plainItems || IsraeliQueueSize(concurrent) != size ||
+        IsraeliQueueToArray(concurrent, concurrentItems, size + 1) !=
+            IsraeliQueueToArray(plain, plainItems, size + 1) ||
+        (size > 0 && memcmp(concurrentItems, plainItems, sizeof(void*) * size) != 0)) {
+        printf("The queues ended up in different orders\n");
+        passed = false;
+    }
+
+    free(concurrentItems);
+    free(plainItems);
+    IsraeliQueueDestroy(concurrent);
+    IsraeliQueueDestroy(plain);
+    return passed;
+}
+
+int main(int argc, char* argv[]) {
+    int threads = argc > 1 ? atoi(argv[1]) : DEFAULT_THREADS;
+    threads = threads < 1 ? 1 : threads > MAX_THREADS ? MAX_THREADS : threads;
+    for (int i = 0; i < MAX_THREADS * ITEMS_PER_THREAD; i++) {
+        items[i] = i;
+    }
+
+    srand(1);
+    bool passed = testThreads(threads);
+    passed = testSequence() && passed;
+    return passed ? 0 : 1;
+}
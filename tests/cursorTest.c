@@ -0,0 +1,218 @@
+// Checks the reading functions against the order a clone of the queue is
+// dequeued in, for both backends. Array backed queues are read with their gap
+// in the middle, at the end, and with the elements before it all dequeued, so
+// the head is right at the gap and every element is after it. Searches with
+// IsraeliQueuePositionOf and IsraeliQueueIsWithinFirst both by address, as
+// queues without a comparison function do, and by value.
+// Usage: cursorTest
+
+#include "IsraeliQueue.c"
+
+#define ITEMS 24
+#define MIDDLE 12
+#define DEQUEUED 5
+
+typedef enum { GAP_END, GAP_MIDDLE, GAP_WRAPPED } GapLayout;
+
+const char* layoutNames[] = { "gap at the end", "gap in the middle", "wrapped" };
+
+int items[ITEMS];
+
+int compareValues(void* first, void* second) {
+    return *(int*)first - *(int*)second;
+}
+
+typedef struct Visits {
+    void* m_seen[ITEMS];
+    int m_count;
+    int m_stopAfter;
+} Visits;
+
+bool visit(void* item, void* context) {
+    Visits* visits = (Visits*)context;
+    visits->m_seen[visits->m_count++] = item;
+    return visits->m_count < visits->m_stopAfter;
+}
+
+// The elements of the queue in order, by dequeuing a clone of it.
+int dequeuedClone(IsraeliQueue q, void** expected) {
+    IsraeliQueue clone = IsraeliQueueClone(q);
+    int count = 0;
+    for (void* item = IsraeliQueueDequeue(clone); item; item = IsraeliQueueDequeue(clone)) {
+        expected[count++] = item;
+    }
+    IsraeliQueueDestroy(clone);
+    return count;
+}
+
+IsraeliQueue createLayout(IsraeliQueueBackend backend, GapLayout layout) {
+    FriendshipFunction friendships[1] = { NULL };
+    IsraeliQueue q = IsraeliQueueCreateWithBackend(friendships, NULL, 10, 5, backend);
+    if (!q) {
+        return NULL;
+    }
+    for (int i = 0; i < ITEMS; i++) {
+        IsraeliQueueEnqueue(q, &items[i]);
+    }
+
+    if (backend == ISRAELIQUEUE_ARRAY && layout != GAP_END) {
+        ArrayMoveGap(q, layout == GAP_MIDDLE ? MIDDLE : DEQUEUED);
+    }
+    if (layout == GAP_WRAPPED) {
+        for (int i = 0; i < DEQUEUED; i++) {
+            IsraeliQueueDequeue(q);
+        }
+    }
+    return q;
+}
+
+// Whether the array backed queue's gap is where the layout puts it.
+bool hasLayout(IsraeliQueue q, GapLayout layout) {
+    if (q->m_backend != ISRAELIQUEUE_ARRAY) {
+        return true;
+    }
+    bool gapEmpty = q->m_gapStart == q->m_gapEnd;
+    if (layout == GAP_END) {
+        return !gapEmpty && q->m_gapEnd == q->m_capacity;
+    }
+    if (layout == GAP_MIDDLE) {
+        return !gapEmpty && q->m_head < q->m_gapStart && q->m_gapEnd < q->m_capacity;
+    }
+    return !gapEmpty && q->m_head == q->m_gapStart && q->m_gapEnd < q->m_capacity;
+}
+
+bool testReading(IsraeliQueue q, const char* name) {
+    void* expected[ITEMS];
+    int size = dequeuedClone(q, expected);
+    if (size != IsraeliQueueSize(q)) {
+        printf("%s: the clone has %d elements, the queue %d\n", name, size, IsraeliQueueSize(q));
+        return false;
+    }
+
+    bool passed = true;
+    IsraeliQueueCursor cursor = IsraeliQueueBegin(q);
+    for (int i = 0; i < size; i++) {
+        if (IsraeliQueueCursorPeek(&cursor) != expected[i] || IsraeliQueueCursorNext(&cursor) != expected[i]) {
+            printf("%s: the cursor differs at position %d\n", name, i);
+            passed = false;
+        }
+    }
+    if (IsraeliQueueCursorPeek(&cursor) || IsraeliQueueCursorNext(&cursor)) {
+        printf("%s: the cursor goes past the tail\n", name);
+        passed = false;
+    }
+
+    for (int i = 0; i < size; i++) {
+        if (IsraeliQueuePeekAt(q, i) != expected[i]) {
+            printf("%s: IsraeliQueuePeekAt differs at position %d\n", name, i);
+            passed = false;
+        }
+    }
+    if (IsraeliQueuePeekAt(q, -1) || IsraeliQueuePeekAt(q, size)) {
+        printf("%s: IsraeliQueuePeekAt returns an element out of range\n", name);
+        passed = false;
+    }
+
+    // Below the size only the first elements are copied, and above it the
+    // rest of the buffer is left as it is.
+    int capacities[] = { size / 2, size + 3 };
+    for (int c = 0; c < 2; c++) {
+        void* buffer[ITEMS + 3];
+        for (int i = 0; i < ITEMS + 3; i++) {
+            buffer[i] = &cursor;
+        }
+        int copied = IsraeliQueueToArray(q, buffer, capacities[c]);
+        int expectedCopied = capacities[c] < size ? capacities[c] : size;
+        bool same = copied == expectedCopied;
+        for (int i = 0; i < ITEMS + 3 && same; i++) {
+            same = buffer[i] == (i < expectedCopied ? expected[i] : &cursor);
+        }
+        if (!same) {
+            printf("%s: IsraeliQueueToArray with capacity %d copied %d elements wrongly\n", name, capacities[c],
+                   copied);
+            passed = false;
+        }
+    }
+
+    Visits visits = { { NULL }, 0, size / 3 };
+    bool same = IsraeliQueueForEach(q, visit, &visits) == ISRAELIQUEUE_SUCCESS && visits.m_count == size / 3;
+    for (int i = 0; i < visits.m_count && same; i++) {
+        same = visits.m_seen[i] == expected[i];
+    }
+    if (!same) {
+        printf("%s: IsraeliQueueForEach visited %d elements, stopping after %d\n", name, visits.m_count,
+               size / 3);
+        passed = false;
+    }
+    return passed;
+}
+
+// Whether item is found at position, or not at all if position is -1, by both
+// search functions, with k below, at and above the size.
+bool expectPosition(IsraeliQueue q, void* item, int position, const char* name, const char* search) {
+    int size = IsraeliQueueSize(q);
+    bool withinFirst = IsraeliQueueIsWithinFirst(q, item, position) ||
+                       IsraeliQueueIsWithinFirst(q, item, 0) || IsraeliQueueIsWithinFirst(q, item, -1);
+    bool found = position >= 0;
+    if (IsraeliQueuePositionOf(q, item) != position || withinFirst ||
+        IsraeliQueueIsWithinFirst(q, item, position + 1) != found ||
+        IsraeliQueueIsWithinFirst(q, item, size) != found || IsraeliQueueIsWithinFirst(q, item, size + 10) != found) {
+        printf("%s: searching %s, IsraeliQueuePositionOf returned %d instead of %d, or "
+               "IsraeliQueueIsWithinFirst disagrees\n", name, search, IsraeliQueuePositionOf(q, item), position);
+        return false;
+    }
+    return true;
+}
+
+bool testSearching(IsraeliQueue q, const char* name) {
+    void* expected[ITEMS];
+    int size = dequeuedClone(q, expected);
+
+    // Without a comparison function, an equal value elsewhere is not the item.
+    bool passed = true;
+    int first = *(int*)expected[0];
+    int absent = -1;
+    for (int i = 0; i < size; i++) {
+        passed = expectPosition(q, expected[i], i, name, "by address") && passed;
+    }
+    passed = expectPosition(q, &first, -1, name, "by address for a copy") && passed;
+    passed = expectPosition(q, &absent, -1, name, "by address for an absent item") && passed;
+    if (IsraeliQueuePositionOf(q, NULL) != -1 || IsraeliQueueIsWithinFirst(q, NULL, size)) {
+        printf("%s: NULL was found\n", name);
+        passed = false;
+    }
+
+    q->m_compare = compareValues;
+    passed = expectPosition(q, &first, 0, name, "by value for a copy") && passed;
+    for (int i = 0; i < size; i++) {
+        int value = *(int*)expected[i];
+        passed = expectPosition(q, &value, i, name, "by value") && passed;
+    }
+    passed = expectPosition(q, &absent, -1, name, "by value for an absent item") && passed;
+    q->m_compare = NULL;
+    return passed;
+}
+
+int main(void) {
+    for (int i = 0; i < ITEMS; i++) {
+        items[i] = i;
+    }
+
+    bool passed = true;
+    for (int backend = 0; backend < 2; backend++) {
+        for (int layout = GAP_END; layout <= GAP_WRAPPED; layout++) {
+            char name[64];
+            sprintf(name, "%s, %s", backend == ISRAELIQUEUE_ARRAY ? "array" : "linked list", layoutNames[layout]);
+
+            IsraeliQueue q = createLayout(backend, layout);
+            if (!q || !hasLayout(q, layout)) {
+                printf("%s: could not lay the queue out\n", name);
+                return 1;
+            }
+            passed = testReading(q, name) && passed;
+            passed = testSearching(q, name) && passed;
+            IsraeliQueueDestroy(q);
+        }
+    }
+    return passed ? 0 : 1;
+}
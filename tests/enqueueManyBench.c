@@ -0,0 +1,85 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "IsraeliQueue.h"
+
+// Enqueues the same items into empty queues of both backends, one at a time
+// with IsraeliQueueEnqueue or in batches of growing size with
+// IsraeliQueueEnqueueMany, reporting the items placed per second. Without
+// friendship measures every enqueue is an append; with one, each item is
+// placed by a scan of the queue, so fewer items are enqueued.
+// Usage: enqueueManyBench [items without measures] [items with a measure]
+
+#define DEFAULT_PLAIN_ITEMS 2000000
+#define DEFAULT_MEASURED_ITEMS 5000
+#define MAX_BATCH 4096
+
+double now(void) {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+int sameTens(void* first, void* second) {
+    return *(int*)first / 10 == *(int*)second / 10 ? 20 : 0;
+}
+
+// Enqueues the items in batches of the given size, or one by one with
+// IsraeliQueueEnqueue if batch is 0, and returns the items placed per second.
+double run(void** items, int n, int batch, IsraeliQueueBackend backend, bool measured) {
+    FriendshipFunction friendships[2] = { measured ? sameTens : NULL, NULL };
+    IsraeliQueue queue = IsraeliQueueCreateWithBackend(friendships, NULL, 10, 5, backend);
+    if (!queue) {
+        exit(1);
+    }
+
+    double start = now();
+    for (int i = 0; i < n; i += batch ? batch : 1) {
+        if (batch == 0) {
+            IsraeliQueueEnqueue(queue, items[i]);
+        } else {
+            IsraeliQueueEnqueueMany(queue, items + i, n - i < batch ? n - i : batch);
+        }
+    }
+    double seconds = now() - start;
+
+    if (IsraeliQueueSize(queue) != n) {
+        exit(1);
+    }
+    IsraeliQueueDestroy(queue);
+    return n / seconds;
+}
+
+int main(int argc, char* argv[]) {
+    int plain = argc > 1 ? atoi(argv[1]) : DEFAULT_PLAIN_ITEMS;
+    int measured = argc > 2 ? atoi(argv[2]) : DEFAULT_MEASURED_ITEMS;
+    int n = plain > measured ? plain : measured;
+
+    int* values = malloc(sizeof(int) * n);
+    void** items = malloc(sizeof(void*) * n);
+    if (!values || !items) {
+        return 1;
+    }
+    for (int i = 0; i < n; i++) {
+        values[i] = rand() % 1000;
+        items[i] = &values[i];
+    }
+
+    for (int m = 0; m < 2; m++) {
+        for (int backend = 0; backend < 2; backend++) {
+            for (int batch = 0; batch <= MAX_BATCH; batch = batch ? batch * 16 : 1) {
+                printf("%s\t%s\t%d\t%.0f\n", m ? "measure" : "none",
+                       backend == ISRAELIQUEUE_ARRAY ? "array" : "list", batch,
+                       run(items, m ? measured : plain, batch, backend, m == 1));
+            }
+        }
+    }
+
+    free(items);
+    free(values);
+    return 0;
+}
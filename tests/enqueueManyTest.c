@@ -0,0 +1,113 @@
+// Checks that IsraeliQueueEnqueueMany places items exactly like the same
+// IsraeliQueueEnqueue calls one after the other would, for both backends, over
+// random queues and batches. Compares the order of the elements and the friend
+// and rival counters of every one of them, and that the batches never call
+// the friendship function more often than the sequential enqueues do.
+// Usage: enqueueManyTest [rounds]
+
+#include "IsraeliQueue.c"
+
+#define DEFAULT_ROUNDS 300
+#define BATCHES 20
+#define MAX_BATCH 40
+#define ITEMS 50
+
+int items[ITEMS];
+long long distanceCalls = 0;
+
+// Friends when close, rivals when far, neutral in between.
+int distance(void* first, void* second) {
+    distanceCalls++;
+    int difference = abs(*(int*)first - *(int*)second);
+    return difference < 4 ? 20 : difference > 40 ? -20 : 0;
+}
+
+bool sameQueues(IsraeliQueue first, IsraeliQueue second) {
+    if (IsraeliQueueSize(first) != IsraeliQueueSize(second)) {
+        return false;
+    }
+
+    IsraeliQueueCursor firstCursor = IsraeliQueueBegin(first);
+    IsraeliQueueCursor secondCursor = IsraeliQueueBegin(second);
+    for (int i = 0; i < IsraeliQueueSize(first); i++) {
+        int firstFriends, firstRivals, secondFriends, secondRivals;
+        if (first->m_backend == ISRAELIQUEUE_ARRAY) {
+            firstFriends = first->m_itemsFriendsCalledOver[firstCursor.m_physical];
+            firstRivals = first->m_itemsRivalsBlocked[firstCursor.m_physical];
+            secondFriends = second->m_itemsFriendsCalledOver[secondCursor.m_physical];
+            secondRivals = second->m_itemsRivalsBlocked[secondCursor.m_physical];
+        } else {
+            firstFriends = ((Node)firstCursor.m_node)->m_friendsCalledOver;
+            firstRivals = ((Node)firstCursor.m_node)->m_rivalsBlocked;
+            secondFriends = ((Node)secondCursor.m_node)->m_friendsCalledOver;
+            secondRivals = ((Node)secondCursor.m_node)->m_rivalsBlocked;
+        }
+
+        if (IsraeliQueueCursorNext(&firstCursor) != IsraeliQueueCursorNext(&secondCursor) ||
+            firstFriends != secondFriends || firstRivals != secondRivals) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool runRound(int round, IsraeliQueueBackend backend) {
+    FriendshipFunction friendships[2] = { distance, NULL };
+    IsraeliQueue batched = IsraeliQueueCreateWithBackend(friendships, NULL, 10, -10, backend);
+    IsraeliQueue sequential = IsraeliQueueCreateWithBackend(friendships, NULL, 10, -10, backend);
+    if (!batched || !sequential) {
+        return false;
+    }
+
+    bool passed = true;
+    for (int batch = 0; batch < BATCHES && passed; batch++) {
+        void* many[MAX_BATCH];
+        int n = rand() % MAX_BATCH;
+        for (int i = 0; i < n; i++) {
+            many[i] = &items[rand() % ITEMS];
+        }
+
+        // A snapshot makes the batched queue copy its arrays before placing the batch.
+        IsraeliQueue snapshot = rand() % 4 ? NULL : IsraeliQueueSnapshot(batched);
+        long long callsBefore = distanceCalls;
+        IsraeliQueueEnqueueMany(batched, many, n);
+        long long batchedCalls = distanceCalls - callsBefore;
+        IsraeliQueueDestroy(snapshot);
+        for (int i = 0; i < n; i++) {
+            IsraeliQueueEnqueue(sequential, many[i]);
+        }
+        long long sequentialCalls = distanceCalls - callsBefore - batchedCalls;
+        for (int i = rand() % 10; i > 0; i--) {
+            IsraeliQueueDequeue(batched);
+            IsraeliQueueDequeue(sequential);
+        }
+
+        if (!sameQueues(batched, sequential)) {
+            printf("Round %d, batch %d: queues differ\n", round, batch);
+            passed = false;
+        }
+        if (batchedCalls > sequentialCalls) {
+            printf("Round %d, batch %d: %lld calls batched, %lld sequential\n", round, batch, batchedCalls,
+                   sequentialCalls);
+            passed = false;
+        }
+    }
+
+    IsraeliQueueDestroy(batched);
+    IsraeliQueueDestroy(sequential);
+    return passed;
+}
+
+int main(int argc, char* argv[]) {
+    int rounds = argc > 1 ? atoi(argv[1]) : DEFAULT_ROUNDS;
+    for (int i = 0; i < ITEMS; i++) {
+        items[i] = i;
+    }
+
+    srand(1);
+    bool passed = true;
+    for (int round = 0; round < rounds; round++) {
+        passed = runRound(round, round % 2 ? ISRAELIQUEUE_ARRAY : ISRAELIQUEUE_LINKED_LIST) && passed;
+    }
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,231 @@
+// Checks the order IsraeliQueueImprovePositions leaves small hand-built queues
+// in, and that both backends leave random queues in the same order. Then
+// checks that ImprovePositions, IsraeliQueueClone and IsraeliQueueDestroy do
+// not recurse over the nodes, by running them on long queues in a thread with
+// a small stack, and that ImprovePositions keeps every element exactly once.
+//
+// ImprovePositions rescans everything in front of each element, so it takes
+// time quadratic in the queue's length, and its queue is shorter than the
+// million elements Clone and Destroy get. With the small stack, a recursion
+// over either queue would still overflow.
+// Usage: improvePositionsTest [elements to improve] [elements to destroy]
+
+#include "IsraeliQueue.c"
+
+#define DEFAULT_IMPROVED_ELEMENTS 20000
+#define DEFAULT_DESTROYED_ELEMENTS 1000000
+#define TEST_STACK_SIZE (64 * 1024)
+#define RANDOM_ROUNDS 200
+#define RANDOM_ELEMENTS 60
+#define RANDOM_ITEMS 30
+
+typedef struct {
+    int m_improved;
+    int m_destroyed;
+    bool m_passed;
+} TestRun;
+
+int sameParity(void* first, void* second) {
+    return *(int*)first % 2 == *(int*)second % 2 ? 10 : 0;
+}
+
+// 0 and 3 are friends, and 1 is a rival of 3.
+int rivalBehindFriend(void* first, void* second) {
+    int sum = *(int*)first + *(int*)second;
+    bool hasThree = *(int*)first == 3 || *(int*)second == 3;
+    return !hasThree ? 0 : sum == 3 ? 10 : sum == 4 ? -10 : 0;
+}
+
+// 0 is a friend of everyone else, who are neutral to each other.
+int friendOfAll(void* first, void* second) {
+    return *(int*)first == 0 || *(int*)second == 0 ? 10 : 0;
+}
+
+// Friends, rivals or neutral, depending on the pair, the same both ways round.
+int hashedRelation(void* first, void* second) {
+    unsigned int pair = (unsigned int)(*(int*)first * *(int*)second + *(int*)first + *(int*)second);
+    return (int)((pair * 2654435761u) >> 28) % 5 - 2;
+}
+
+// Appends 0 to n - 1 to a queue of the given backend, adds the measure and
+// improves the positions, then checks the queue holds the expected order.
+bool testOrder(const char* name, FriendshipFunction measure, int n, const int* expected,
+               IsraeliQueueBackend backend) {
+    int items[16];
+    FriendshipFunction friendships[1] = { NULL };
+    IsraeliQueue q = IsraeliQueueCreateWithBackend(friendships, NULL, 5, -5, backend);
+    if (!q) {
+        return false;
+    }
+    for (int i = 0; i < n; i++) {
+        items[i] = i;
+        IsraeliQueueEnqueue(q, &items[i]);
+    }
+    IsraeliQueueAddFriendshipMeasure(q, measure);
+    IsraeliQueueImprovePositions(q);
+
+    bool passed = IsraeliQueueSize(q) == n;
+    for (int i = 0; i < n && passed; i++) {
+        passed = *(int*)IsraeliQueuePeekAt(q, i) == expected[i];
+    }
+    if (!passed) {
+        printf("%s: wrong order on the %s backend\n", name,
+               backend == ISRAELIQUEUE_ARRAY ? "array" : "linked list");
+    }
+    IsraeliQueueDestroy(q);
+    return passed;
+}
+
+bool testOrders(void) {
+    // Each even element goes behind 0, and each odd one behind 1.
+    int parity[] = { 0, 2, 4, 1, 3 };
+    // 3 goes behind its friend 0, but 1 blocks it, so it goes behind 1.
+    int blocked[] = { 0, 1, 3, 2 };
+    // 0 lets five friends in front of 1 before its quota runs out.
+    int quota[] = { 0, 3, 4, 5, 6, 7, 1, 2 };
+
+    bool passed = true;
+    for (int backend = 0; backend < 2; backend++) {
+        passed = testOrder("parity", sameParity, 5, parity, backend) && passed;
+        passed = testOrder("blocked", rivalBehindFriend, 4, blocked, backend) && passed;
+        passed = testOrder("quota", friendOfAll, 8, quota, backend) && passed;
+    }
+    return passed;
+}
+
+// Places the same random items in queues of both backends, improves their
+// positions and checks that they end up in the same order.
+bool testBackendsAgree(void) {
+    int items[RANDOM_ITEMS];
+    for (int i = 0; i < RANDOM_ITEMS; i++) {
+        items[i] = i;
+    }
+
+    srand(1);
+    for (int round = 0; round < RANDOM_ROUNDS; round++) {
+        FriendshipFunction friendships[2] = { hashedRelation, NULL };
+        IsraeliQueue list = IsraeliQueueCreate(friendships, NULL, 1, -1);
+        IsraeliQueue array = IsraeliQueueCreateWithBackend(friendships, NULL, 1, -1, ISRAELIQUEUE_ARRAY);
+        if (!list || !array) {
+            return false;
+        }
+        for (int i = 0; i < RANDOM_ELEMENTS; i++) {
+            void* item = &items[rand() % RANDOM_ITEMS];
+            IsraeliQueueEnqueue(list, item);
+            IsraeliQueueEnqueue(array, item);
+            if (rand() % 5 == 0) {
+                IsraeliQueueDequeue(list);
+                IsraeliQueueDequeue(array);
+            }
+        }
+        IsraeliQueueImprovePositions(list);
+        IsraeliQueueImprovePositions(array);
+
+        void* listItems[RANDOM_ELEMENTS];
+        void* arrayItems[RANDOM_ELEMENTS];
+        int size = IsraeliQueueToArray(list, listItems, RANDOM_ELEMENTS);
+        if (IsraeliQueueToArray(array, arrayItems, RANDOM_ELEMENTS) != size ||
+            memcmp(listItems, arrayItems, sizeof(void*) * size) != 0) {
+            printf("Round %d: the backends' orders differ\n", round);
+            return false;
+        }
+
+        IsraeliQueueDestroy(list);
+        IsraeliQueueDestroy(array);
+    }
+    return true;
+}
+
+bool testImprovePositions(int elements) {
+    int* items = malloc(sizeof(int) * elements);
+    char* seen = calloc(elements, 1);
+    FriendshipFunction friendships[1] = { NULL };
+    IsraeliQueue q = IsraeliQueueCreate(friendships, NULL, 5, -5);
+    if (!items || !seen || !q) {
+        return false;
+    }
+
+    // Appended before the friendship measure is added, so that ImprovePositions
+    // has elements to move all along the queue.
+    for (int i = 0; i < elements; i++) {
+        items[i] = i;
+        if (IsraeliQueueEnqueue(q, &items[i]) != ISRAELIQUEUE_SUCCESS) {
+            return false;
+        }
+    }
+    if (IsraeliQueueAddFriendshipMeasure(q, sameParity) != ISRAELIQUEUE_SUCCESS ||
+        IsraeliQueueImprovePositions(q) != ISRAELIQUEUE_SUCCESS) {
+        printf("IsraeliQueueImprovePositions failed\n");
+        return false;
+    }
+
+    int walked = 0;
+    for (Node node = q->m_list; node; node = node->m_next) {
+        int item = *(int*)node->m_data;
+        if (seen[item]) {
+            printf("Element %d appears twice\n", item);
+            return false;
+        }
+        seen[item] = 1;
+        walked++;
+    }
+    if (walked != elements || IsraeliQueueSize(q) != elements) {
+        printf("Expected %d elements, walked %d, size %d\n", elements, walked, IsraeliQueueSize(q));
+        return false;
+    }
+
+    IsraeliQueueDestroy(q);
+    free(seen);
+    free(items);
+    return true;
+}
+
+bool testDestroy(int elements) {
+    int item = 0;
+    FriendshipFunction friendships[1] = { NULL };
+    IsraeliQueue q = IsraeliQueueCreate(friendships, NULL, 5, -5);
+    if (!q) {
+        return false;
+    }
+
+    for (int i = 0; i < elements; i++) {
+        if (IsraeliQueueEnqueue(q, &item) != ISRAELIQUEUE_SUCCESS) {
+            return false;
+        }
+    }
+    IsraeliQueue clone = IsraeliQueueClone(q);
+    if (!clone || IsraeliQueueSize(clone) != elements) {
+        printf("IsraeliQueueClone failed\n");
+        return false;
+    }
+
+    IsraeliQueueDestroy(clone);
+    IsraeliQueueDestroy(q);
+    return true;
+}
+
+void* runTests(void* argument) {
+    TestRun* run = argument;
+    run->m_passed = testOrders() && testBackendsAgree() && testImprovePositions(run->m_improved) &&
+                    testDestroy(run->m_destroyed);
+    return NULL;
+}
+
+int main(int argc, char* argv[]) {
+    TestRun run = {
+        argc > 1 ? atoi(argv[1]) : DEFAULT_IMPROVED_ELEMENTS,
+        argc > 2 ? atoi(argv[2]) : DEFAULT_DESTROYED_ELEMENTS,
+        false
+    };
+
+    pthread_attr_t attributes;
+    pthread_t thread;
+    pthread_attr_init(&attributes);
+    pthread_attr_setstacksize(&attributes, TEST_STACK_SIZE);
+    if (pthread_create(&thread, &attributes, runTests, &run) != 0) {
+        return 1;
+    }
+    pthread_join(thread, NULL);
+    pthread_attr_destroy(&attributes);
+    return run.m_passed ? 0 : 1;
+}
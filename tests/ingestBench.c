@@ -0,0 +1,129 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "IsraeliQueue.h"
+
+// Runs 1 to 32 producer threads that enqueue a fixed number of elements in
+// total, split between them, either directly into a queue made by
+// IsraeliQueueCreateConcurrent or by pushing into an IsraeliQueueIngestBuffer
+// that one consumer thread drains. Reports the elements placed per second,
+// from the first push until the last element is in the queue, and the
+// percentiles of the time a single enqueue or push took the producer.
+// Usage: ingestBench <direct|ingest> [elements] [buffer capacity]
+
+#define DEFAULT_ELEMENTS 20000
+#define DEFAULT_CAPACITY 4096
+#define MAX_THREADS 32
+
+typedef struct {
+    IsraeliQueue m_queue;
+    IsraeliQueueIngestBuffer m_buffer;
+    int* m_items;
+    int m_count;
+    double* m_latencies;
+} Producer;
+
+double now(void) {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+int sameTens(void* first, void* second) {
+    return *(int*)first / 10 == *(int*)second / 10 ? 20 : 0;
+}
+
+int compareLatencies(const void* first, const void* second) {
+    double difference = *(const double*)first - *(const double*)second;
+    return (difference > 0) - (difference < 0);
+}
+
+void* produce(void* argument) {
+    Producer* producer = argument;
+    for (int i = 0; i < producer->m_count; i++) {
+        double start = now();
+        if (producer->m_buffer) {
+            while (IsraeliQueueIngestBufferPush(producer->m_buffer, &producer->m_items[i]) != ISRAELIQUEUE_SUCCESS) {
+                sched_yield();
+            }
+        } else {
+            IsraeliQueueEnqueue(producer->m_queue, &producer->m_items[i]);
+        }
+        producer->m_latencies[i] = now() - start;
+    }
+    return NULL;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2 || (strcmp(argv[1], "direct") != 0 && strcmp(argv[1], "ingest") != 0)) {
+        printf("Usage: %s <direct|ingest> [elements] [buffer capacity]\n", argv[0]);
+        return 1;
+    }
+    bool ingest = strcmp(argv[1], "ingest") == 0;
+    int elements = argc > 2 ? atoi(argv[2]) : DEFAULT_ELEMENTS;
+    int capacity = argc > 3 ? atoi(argv[3]) : DEFAULT_CAPACITY;
+
+    int* items = malloc(sizeof(int) * elements);
+    double* latencies = malloc(sizeof(double) * elements);
+    if (!items || !latencies) {
+        return 1;
+    }
+    for (int i = 0; i < elements; i++) {
+        items[i] = i;
+    }
+
+    for (int threads = 1; threads <= MAX_THREADS; threads *= 2) {
+        FriendshipFunction friendships[2] = { sameTens, NULL };
+        IsraeliQueue queue = ingest ? IsraeliQueueCreate(friendships, NULL, 10, 5)
+                                    : IsraeliQueueCreateConcurrent(friendships, NULL, 10, 5);
+        IsraeliQueueIngestBuffer buffer = ingest ? IsraeliQueueIngestBufferCreate(queue, capacity) : NULL;
+        if (!queue || (ingest && !buffer)) {
+            return 1;
+        }
+
+        Producer producers[MAX_THREADS];
+        pthread_t ids[MAX_THREADS];
+        double start = now();
+        for (int i = 0, first = 0; i < threads; i++) {
+            int count = elements / threads + (i < elements % threads);
+            producers[i] = (Producer){ queue, buffer, items + first, count, latencies + first };
+            first += count;
+            if (pthread_create(&ids[i], NULL, produce, &producers[i]) != 0) {
+                return 1;
+            }
+        }
+
+        // This thread is the consumer: it places the elements while the producers push them.
+        for (int placed = 0; ingest && placed < elements;) {
+            int drained;
+            if (IsraeliQueueIngestBufferDrain(buffer, &drained) != ISRAELIQUEUE_SUCCESS) {
+                return 1;
+            }
+            placed += drained;
+            if (drained == 0) {
+                sched_yield();
+            }
+        }
+        for (int i = 0; i < threads; i++) {
+            pthread_join(ids[i], NULL);
+        }
+        double seconds = now() - start;
+
+        qsort(latencies, elements, sizeof(double), compareLatencies);
+        printf("%s\t%d\t%.0f\t%.0f\t%.0f\t%.0f\t%.0f\t%d\n", argv[1], threads, elements / seconds,
+               latencies[elements / 2] * 1e9, latencies[(int)(elements * 0.99)] * 1e9,
+               latencies[(int)(elements * 0.999)] * 1e9, latencies[elements - 1] * 1e9, IsraeliQueueSize(queue));
+
+        IsraeliQueueIngestBufferDestroy(buffer);
+        IsraeliQueueDestroy(queue);
+    }
+    free(items);
+    free(latencies);
+    return 0;
+}
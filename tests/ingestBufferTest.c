@@ -0,0 +1,174 @@
+// Checks IsraeliQueueIngestBuffer with a capacity of 8 and several producers
+// pushing at once, retrying while the buffer is full: the thread draining it
+// must get every item exactly once, and each producer's items in the order it
+// pushed them. Then makes a drain fail to allocate, for both backends, and
+// checks that the items stay in the buffer, still taking up its room, and are
+// placed by the next drain.
+// Usage: ingestBufferTest [producers]
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+
+// Allocations made by the queue fail while failAllocations is set.
+void* failingMalloc(size_t size);
+#define malloc failingMalloc
+#include "IsraeliQueue.c"
+#undef malloc
+
+#define CAPACITY 8
+#define DEFAULT_PRODUCERS 4
+#define MAX_PRODUCERS 16
+#define ITEMS_PER_PRODUCER 5000
+#define STUCK_ITEMS 5
+
+bool failAllocations = false;
+
+void* failingMalloc(size_t size) {
+    return failAllocations ? NULL : malloc(size);
+}
+
+int items[MAX_PRODUCERS * ITEMS_PER_PRODUCER];
+int placed[MAX_PRODUCERS * ITEMS_PER_PRODUCER];
+int producersDone = 0;
+
+typedef struct Producer {
+    IsraeliQueueIngestBuffer m_buffer;
+    int m_first;
+} Producer;
+
+void* produce(void* argument) {
+    Producer* producer = argument;
+    for (int i = 0; i < ITEMS_PER_PRODUCER; i++) {
+        while (IsraeliQueueIngestBufferPush(producer->m_buffer, &items[producer->m_first + i]) !=
+               ISRAELIQUEUE_SUCCESS) {
+            sched_yield();
+        }
+    }
+    __atomic_add_fetch(&producersDone, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+bool testProducers(int producers) {
+    FriendshipFunction friendships[1] = { NULL };
+    IsraeliQueue q = IsraeliQueueCreate(friendships, NULL, 10, 0);
+    IsraeliQueueIngestBuffer buffer = IsraeliQueueIngestBufferCreate(q, CAPACITY);
+    if (!q || !buffer) {
+        return false;
+    }
+
+    Producer workers[MAX_PRODUCERS];
+    pthread_t ids[MAX_PRODUCERS];
+    for (int p = 0; p < producers; p++) {
+        Producer producer = { buffer, p * ITEMS_PER_PRODUCER };
+        workers[p] = producer;
+        if (pthread_create(&ids[p], NULL, produce, &workers[p]) != 0) {
+            printf("Could not start producer %d\n", p);
+            return false;
+        }
+    }
+
+    // Without friendship measures the queue keeps the order of the drains.
+    bool passed = true;
+    int next[MAX_PRODUCERS] = { 0 };
+    int total = producers * ITEMS_PER_PRODUCER;
+    for (int seen = 0; seen < total;) {
+        bool done = __atomic_load_n(&producersDone, __ATOMIC_ACQUIRE) == producers;
+        int drained = 0;
+        if (IsraeliQueueIngestBufferDrain(buffer, &drained) != ISRAELIQUEUE_SUCCESS || drained > CAPACITY) {
+            printf("A drain failed or drained %d items\n", drained);
+            return false;
+        }
+        if (drained == 0 && done) {
+            break;
+        }
+        if (drained == 0) {
+            sched_yield();
+        }
+
+        for (void* item = IsraeliQueueDequeue(q); item; item = IsraeliQueueDequeue(q), seen++) {
+            int index = (int*)item - items;
+            int producer = index / ITEMS_PER_PRODUCER;
+            placed[index]++;
+            if (index % ITEMS_PER_PRODUCER != next[producer]++ && passed) {
+                printf("Producer %d's item %d came out of order\n", producer, index % ITEMS_PER_PRODUCER);
+                passed = false;
+            }
+        }
+    }
+
+    for (int p = 0; p < producers; p++) {
+        pthread_join(ids[p], NULL);
+    }
+    for (int i = 0; i < total; i++) {
+        if (placed[i] != 1) {
+            printf("Item %d was placed %d times\n", i, placed[i]);
+            passed = false;
+        }
+    }
+
+    IsraeliQueueIngestBufferDestroy(buffer);
+    IsraeliQueueDestroy(q);
+    return passed;
+}
+
+bool testFailedDrain(IsraeliQueueBackend backend) {
+    const char* name = backend == ISRAELIQUEUE_ARRAY ? "array" : "linked list";
+    FriendshipFunction friendships[1] = { NULL };
+    IsraeliQueue q = IsraeliQueueCreateWithBackend(friendships, NULL, 10, 0, backend);
+    IsraeliQueueIngestBuffer buffer = IsraeliQueueIngestBufferCreate(q, CAPACITY);
+    if (!q || !buffer) {
+        return false;
+    }
+    for (int i = 0; i < STUCK_ITEMS; i++) {
+        IsraeliQueueIngestBufferPush(buffer, &items[i]);
+    }
+
+    // The queue has no nodes or arrays yet, so placing the items allocates.
+    bool passed = true;
+    int drained = -1;
+    failAllocations = true;
+    IsraeliQueueError error = IsraeliQueueIngestBufferDrain(buffer, &drained);
+    failAllocations = false;
+    if (error != ISRAELIQUEUE_ALLOC_FAILED || drained != 0 || IsraeliQueueSize(q) != 0) {
+        printf("%s: a failed drain returned %d and drained %d items\n", name, error, drained);
+        passed = false;
+    }
+
+    // The items still hold their slots, so only the rest of the room is free.
+    for (int i = STUCK_ITEMS; i < CAPACITY; i++) {
+        passed = IsraeliQueueIngestBufferPush(buffer, &items[i]) == ISRAELIQUEUE_SUCCESS && passed;
+    }
+    if (IsraeliQueueIngestBufferPush(buffer, &items[CAPACITY]) != ISRAELI_QUEUE_ERROR || !passed) {
+        printf("%s: the room left after a failed drain is wrong\n", name);
+        passed = false;
+    }
+
+    if (IsraeliQueueIngestBufferDrain(buffer, &drained) != ISRAELIQUEUE_SUCCESS || drained != CAPACITY) {
+        printf("%s: the drain after a failed one drained %d items\n", name, drained);
+        passed = false;
+    }
+    for (int i = 0; i < CAPACITY; i++) {
+        if (IsraeliQueueDequeue(q) != &items[i]) {
+            printf("%s: item %d was not placed in order after a failed drain\n", name, i);
+            passed = false;
+        }
+    }
+
+    IsraeliQueueIngestBufferDestroy(buffer);
+    IsraeliQueueDestroy(q);
+    return passed;
+}
+
+int main(int argc, char* argv[]) {
+    int producers = argc > 1 ? atoi(argv[1]) : DEFAULT_PRODUCERS;
+    producers = producers < 1 ? 1 : producers > MAX_PRODUCERS ? MAX_PRODUCERS : producers;
+    for (int i = 0; i < MAX_PRODUCERS * ITEMS_PER_PRODUCER; i++) {
+        items[i] = i;
+    }
+
+    bool passed = testProducers(producers);
+    passed = testFailedDrain(ISRAELIQUEUE_LINKED_LIST) && passed;
+    passed = testFailedDrain(ISRAELIQUEUE_ARRAY) && passed;
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,94 @@
+#!/bin/bash
+
+# Randomized differential test of friendship measure ordering. Compares the
+# outputs of HackEnrollment with its measures called in the order they were
+# added ('-g') to its default fused scorer and to the measures reordered by
+# cost and by how decisive they are ('-o'), with and without '-i', on inputs
+# where the order of the measures could change the result: close ids, short
+# names with non-ASCII bytes, and many rivals.
+# Usage: tests/measureOrderTest.sh [rounds], from the repository's root.
+
+GREEN='\033[0;32m'
+RED='\033[0;31m'
+NC='\033[0m' # No Color
+TMP=$(mktemp -d)
+BIN=$TMP/HackEnrollment
+rounds=${1:-50}
+failed=0
+
+# Writes a course with a queue of students and hackers with friends and rivals
+# near them to the given directory. Ids and names are close enough for a rival
+# to be a friend by the other measures alone. Usage: generate <dir> <seed>
+generate() {
+   LC_ALL=C awk -v dir="$1" -v seed="$2" '
+   function name(    out, size, c) {
+      out = ""
+      size = rand() < 0.9 ? 2 : 1 + int(rand() * 3)
+      for (c = 0; c < size; c++) {
+         if (rand() < 0.05) {
+            out = out sprintf("%c", 128 + int(rand() * 128))
+         } else {
+            out = out substr("abAB", 1 + int(rand() * 4), 1)
+         }
+      }
+      return out
+   }
+   BEGIN {
+      srand(seed)
+      next_id = 100000000
+      for (i = 0; i < 240; i++) {
+         next_id += int(rand() * 3)
+         id[i] = next_id
+         printf "%d 10 80 %s %s Haifa CS\n", id[i], name(), name() > dir "/students.txt"
+      }
+      printf "1 240\n" > dir "/courses.txt"
+      printf "1" > dir "/queues.txt"
+      for (i = 0; i < 240; i++) {
+         if (i % 3) {
+            printf " %d", id[i] > dir "/queues.txt"
+         }
+      }
+      printf "\n" > dir "/queues.txt"
+      for (h = 0; h < 240; h += 3) {
+         printf "%d\n1\n", id[h] > dir "/hackers.txt"
+         for (list = 0; list < 2; list++) {
+            for (f = 0; f < 4; f++) {
+               near = h + int(rand() * 61) - 30
+               near = near < 0 ? -near : (near >= 240 ? 479 - near : near)
+               printf "%s%d", f ? " " : "", id[near] > dir "/hackers.txt"
+            }
+            printf "\n" > dir "/hackers.txt"
+         }
+      }
+   }'
+}
+
+gcc -std=c99 -pthread -I. -Itool -Wall -pedantic-errors -Werror -DNDEBUG \
+   IsraeliQueue.c tool/HackEnrollment.c tool/main.c -lm -o $BIN || exit 1
+
+for ((round = 1; round <= rounds; round++)); do
+   rm -f $TMP/*.txt
+   generate $TMP $round
+   for flag in "" "-i"; do
+      $BIN -g $flag $TMP/students.txt $TMP/courses.txt $TMP/hackers.txt $TMP/queues.txt $TMP/generic.out
+      $BIN $flag $TMP/students.txt $TMP/courses.txt $TMP/hackers.txt $TMP/queues.txt $TMP/fused.out
+      if ! cmp -s $TMP/generic.out $TMP/fused.out; then
+         echo -e "Round $round $flag fused: ${RED}outputs differ${NC}"
+         failed=1
+      fi
+      for order in cost decisive; do
+         $BIN -o $order $flag $TMP/students.txt $TMP/courses.txt $TMP/hackers.txt $TMP/queues.txt \
+            $TMP/$order.out
+         if ! cmp -s $TMP/generic.out $TMP/$order.out; then
+            echo -e "Round $round $flag -o $order: ${RED}outputs differ${NC}"
+            failed=1
+         fi
+      done
+   done
+done
+
+if [ $failed = 0 ]; then
+   echo -e "${GREEN}All $rounds rounds matched${NC}"
+fi
+rm -r $TMP
+exit $failed
@@ -0,0 +1,100 @@
+// Checks the calls, early exits and positions IsraeliQueueGetMeasureStats
+// reports for three measures, one of which always decides a pair are friends,
+// before and after the queue reorders them by how decisive they are, and in a
+// clone. Replacing a lower bound must replace it in the total the queue keeps,
+// or the decisive measure stops ending the scoring once it is called first.
+// Usage: measureStatsTest
+
+#include "IsraeliQueue.c"
+
+#define LATE_PAIRS 100
+#define CLONE_PAIRS 10
+
+int first = 0;
+int second = 1;
+
+int zero(void* person1, void* person2) {
+    return 0;
+}
+
+int one(void* person1, void* person2) {
+    return 1;
+}
+
+int decisive(void* person1, void* person2) {
+    return 25;
+}
+
+bool scorePairs(IsraeliQueue q, int pairs) {
+    for (int i = 0; i < pairs; i++) {
+        if (computeFriendshipStatus(q, &first, &second) != FRIEND) {
+            printf("A pair was not decided as friends\n");
+            return false;
+        }
+    }
+    return true;
+}
+
+bool expectStats(IsraeliQueue q, int index, long long calls, long long exits, int position, const char* step) {
+    long long actualCalls, actualExits;
+    int actualPosition;
+    if (IsraeliQueueGetMeasureStats(q, index, &actualCalls, &actualExits, NULL, &actualPosition) !=
+        ISRAELIQUEUE_SUCCESS) {
+        printf("%s: no statistics for measure %d\n", step, index);
+        return false;
+    }
+
+    if (actualCalls != calls || actualExits != exits || actualPosition != position) {
+        printf("%s: measure %d has %lld calls, %lld exits, position %d, expected %lld, %lld, %d\n", step, index,
+               actualCalls, actualExits, actualPosition, calls, exits, position);
+        return false;
+    }
+    return true;
+}
+
+int main(void) {
+    FriendshipFunction friendships[4] = { zero, one, decisive, NULL };
+    IsraeliQueue q = IsraeliQueueCreate(friendships, NULL, 20, 0);
+    if (!q || IsraeliQueueSetMeasureLowerBound(q, zero, -100) != ISRAELIQUEUE_SUCCESS ||
+        IsraeliQueueSetMeasureLowerBound(q, one, 1) != ISRAELIQUEUE_SUCCESS ||
+        IsraeliQueueSetMeasureOrder(q, ISRAELIQUEUE_ORDER_DECISIVE) != ISRAELIQUEUE_SUCCESS) {
+        return 1;
+    }
+
+    // Before the first reorder every pair is only decided by the last measure.
+    int early = MEASURE_REORDER_INTERVAL - 1;
+    bool passed = scorePairs(q, early);
+    passed = expectStats(q, 0, early, 0, 0, "registration order") && passed;
+    passed = expectStats(q, 1, early, 0, 1, "registration order") && passed;
+    passed = expectStats(q, 2, early, early, 2, "registration order") && passed;
+
+    // With the bounds at 0 and 1, the decisive measure alone decides a pair
+    // once it is called first.
+    IsraeliQueueSetMeasureLowerBound(q, zero, 0);
+    passed = scorePairs(q, LATE_PAIRS) && passed;
+    passed = expectStats(q, 0, early, 0, 1, "decisive order") && passed;
+    passed = expectStats(q, 1, early, 0, 2, "decisive order") && passed;
+    passed = expectStats(q, 2, early + LATE_PAIRS, early + LATE_PAIRS, 0, "decisive order") && passed;
+
+    // A clone keeps the order and the bounds, and collects its own statistics.
+    IsraeliQueue clone = IsraeliQueueClone(q);
+    if (!clone) {
+        return 1;
+    }
+    passed = scorePairs(clone, CLONE_PAIRS) && passed;
+    passed = expectStats(clone, 0, 0, 0, 1, "clone") && passed;
+    passed = expectStats(clone, 1, 0, 0, 2, "clone") && passed;
+    passed = expectStats(clone, 2, CLONE_PAIRS, CLONE_PAIRS, 0, "clone") && passed;
+
+    // Going back to the default order restores the positions, and stops
+    // collecting statistics.
+    IsraeliQueueSetMeasureOrder(q, ISRAELIQUEUE_ORDER_REGISTRATION);
+    passed = scorePairs(q, LATE_PAIRS) && passed;
+    passed = expectStats(q, 0, early, 0, 0, "back to registration order") && passed;
+    passed = expectStats(q, 1, early, 0, 1, "back to registration order") && passed;
+    passed = expectStats(q, 2, early + LATE_PAIRS, early + LATE_PAIRS, 2, "back to registration order") && passed;
+
+    IsraeliQueueDestroy(clone);
+    IsraeliQueueDestroy(q);
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,111 @@
+// Randomized differential test of the vectorized stringDiff kernels. Pads
+// random names and surnames the way students' names are padded, case folded
+// or not, and checks that paddedNamesDiffSSE2 and paddedNamesDiffAVX2 return
+// exactly the sum of stringDiff over the name and the surname. Lengths
+// cluster around the padding size, and some names hold bytes with the high
+// bit set, which must keep a student on the scalar stringDiff.
+// Usage: nameDiffKernelTest [rounds]
+
+#include "IsraeliQueue.c"
+#include "HackEnrollment.c"
+
+#define DEFAULT_ROUNDS 200000
+
+char randomByte(void) {
+    if (rand() % 50 == 0) {
+        return (char)(SCHAR_MAX + 1 + rand() % (UCHAR_MAX - SCHAR_MAX));
+    }
+    return (char)(1 + rand() % SCHAR_MAX);
+}
+
+// A random name of up to two bytes past the padding size, mostly of a length
+// right around one of the boundaries of the kernels' loads.
+StringView randomName(char* buffer) {
+    int boundaries[] = { 0, 1, NAME_PAD_SIZE - 1, NAME_PAD_SIZE, NAME_PAD_SIZE + 1 };
+    int length = rand() % 2 ? boundaries[rand() % 5] : rand() % (NAME_PAD_SIZE + 3);
+    for (int i = 0; i < length; i++) {
+        buffer[i] = randomByte();
+    }
+
+    StringView name = { buffer, length };
+    return name;
+}
+
+StringView foldName(StringView name, char* buffer) {
+    for (int i = 0; i < name.m_length; i++) {
+        buffer[i] = lowerCaseChar(name.m_data[i]);
+    }
+
+    StringView folded = { buffer, name.m_length };
+    return folded;
+}
+
+bool fitsPadding(StringView name) {
+    if (name.m_length > NAME_PAD_SIZE) {
+        return false;
+    }
+    for (int i = 0; i < name.m_length; i++) {
+        if ((unsigned char)name.m_data[i] > SCHAR_MAX) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+#if defined(HACKENROLLMENT_SSE2)
+    int rounds = argc > 1 ? atoi(argv[1]) : DEFAULT_ROUNDS;
+#if defined(HACKENROLLMENT_AVX2)
+    bool avx2 = __builtin_cpu_supports("avx2");
+#endif
+    int failures = 0;
+
+    srand(1);
+    for (int round = 0; round < rounds; round++) {
+        char buffers[8][NAME_PAD_SIZE + 2];
+        StringView names[2][2];
+        struct Student_t students[2];
+        bool caseSensitive = rand() % 2;
+
+        for (int i = 0; i < 2; i++) {
+            names[i][0] = randomName(buffers[4 * i]);
+            names[i][1] = randomName(buffers[4 * i + 1]);
+            if (caseSensitive) {
+                padStudentNames(&students[i], names[i][0], names[i][1]);
+            } else {
+                padStudentNames(&students[i], foldName(names[i][0], buffers[4 * i + 2]),
+                                foldName(names[i][1], buffers[4 * i + 3]));
+            }
+
+            bool fits = fitsPadding(names[i][0]) && fitsPadding(names[i][1]);
+            if (students[i].m_hasPaddedNames != fits) {
+                printf("Round %d: names %s padded\n", round, fits ? "not" : "wrongly");
+                failures++;
+            }
+        }
+        if (!students[0].m_hasPaddedNames || !students[1].m_hasPaddedNames) {
+            continue;
+        }
+
+        int expected = stringDiff(names[0][0], names[1][0], caseSensitive) +
+                       stringDiff(names[0][1], names[1][1], caseSensitive);
+        int sse2 = paddedNamesDiffSSE2(students[0].m_paddedNames, students[1].m_paddedNames);
+        if (sse2 != expected) {
+            printf("Round %d: stringDiff %d, SSE2 %d\n", round, expected, sse2);
+            failures++;
+        }
+#if defined(HACKENROLLMENT_AVX2)
+        int avx2Sum = avx2 ? paddedNamesDiffAVX2(students[0].m_paddedNames, students[1].m_paddedNames)
+                           : expected;
+        if (avx2Sum != expected) {
+            printf("Round %d: stringDiff %d, AVX2 %d\n", round, expected, avx2Sum);
+            failures++;
+        }
+#endif
+    }
+    return failures ? 1 : 0;
+#else
+    printf("No vectorized stringDiff on this target\n");
+    return 0;
+#endif
+}
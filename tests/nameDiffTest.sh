@@ -0,0 +1,102 @@
+#!/bin/bash
+
+# Randomized differential test of the vectorized stringDiff. Builds HackEnrollment
+# with the scalar, SSE2 and AVX2 versions, and compares their outputs, with and
+# without '-i', on inputs with random names of mixed case, lengths and bytes.
+# Usage: tests/nameDiffTest.sh [rounds], from the repository's root.
+
+GREEN='\033[0;32m'
+RED='\033[0;31m'
+NC='\033[0m' # No Color
+TMP=$(mktemp -d)
+rounds=${1:-50}
+failed=0
+
+build() {
+   local out=$1
+   shift
+   gcc -std=c99 -pthread -I. -Itool -Wall -pedantic-errors -Werror -DNDEBUG "$@" \
+      IsraeliQueue.c tool/HackEnrollment.c tool/main.c -lm -o $out
+}
+
+# Writes a course that hackers with random names are placed in, by name
+# similarity, to the given directory. All ids are 0 to atoi, so only names
+# decide who is friends, and names are close enough for sums near the threshold.
+# Usage: generate <dir> <seed>
+generate() {
+   LC_ALL=C awk -v dir="$1" -v seed="$2" '
+   function mutate(name,    at, c, ascii) {
+      ascii = "!\"#$%&()*+,-./0123456789:;<=>?@ABCDEFGHIJKLMNOPQRSTUVWXYZ[]^_`abcdefghijklmnopqrstuvwxyz{|}~"
+      at = 1 + int(rand() * length(name))
+      c = index(ascii, substr(name, at, 1))
+      if (c && rand() < 0.6) {
+         c = c + int(rand() * 7) - 3
+         c = c < 1 ? 1 : (c > length(ascii) ? length(ascii) : c)
+         name = substr(name, 1, at - 1) substr(ascii, c, 1) substr(name, at + 1)
+      }
+      if (rand() < 0.15) {
+         name = toupper(substr(name, 1, at - 1)) tolower(substr(name, at))
+      }
+      if (rand() < 0.1 && length(name) > 1) {
+         name = substr(name, 1, length(name) - 1)
+      }
+      if (rand() < 0.1) {
+         name = name substr("ABCDEFGHIJKLMNOPQRSTUVWXYZ", 1 + int(rand() * 26), 1)
+      }
+      return name
+   }
+   BEGIN {
+      srand(seed)
+      letters = "ABCDEFGHIJKLMNOPQRSTUVWXYZABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz"
+      for (p = 0; p < 4; p++) {
+         pool[p] = ""
+         size = 1 + int(rand() * 22)
+         for (c = 0; c < size; c++) {
+            if (rand() < 0.02) {
+               pool[p] = pool[p] sprintf("%c", 128 + int(rand() * 128))
+            } else {
+               pool[p] = pool[p] substr(letters, 1 + int(rand() * length(letters)), 1)
+            }
+         }
+      }
+      for (i = 0; i < 300; i++) {
+         id[i] = sprintf("0000000%c%c", 97 + int(i / 26), 97 + i % 26)
+         printf "%s 10 80 %s %s Haifa CS\n", id[i], mutate(pool[int(rand() * 2)]),
+            mutate(pool[2 + int(rand() * 2)]) > dir "/students.txt"
+      }
+      printf "1 150\n" > dir "/courses.txt"
+      printf "1" > dir "/queues.txt"
+      for (i = 100; i < 300; i++) {
+         printf " %s", id[i] > dir "/queues.txt"
+      }
+      printf "\n" > dir "/queues.txt"
+      for (h = 0; h < 100; h++) {
+         printf "%s\n1\n\n\n", id[h] > dir "/hackers.txt"
+      }
+   }'
+}
+
+build $TMP/scalar -DHACKENROLLMENT_NO_SIMD || exit 1
+build $TMP/sse2 -DHACKENROLLMENT_NO_AVX2 || exit 1
+build $TMP/avx2 || exit 1
+
+for ((round = 1; round <= rounds; round++)); do
+   rm -f $TMP/*.txt
+   generate $TMP $round
+   for flag in "" "-i"; do
+      for version in scalar sse2 avx2; do
+         $TMP/$version $flag $TMP/students.txt $TMP/courses.txt $TMP/hackers.txt $TMP/queues.txt \
+            $TMP/$version.out
+      done
+      if ! cmp -s $TMP/scalar.out $TMP/sse2.out || ! cmp -s $TMP/scalar.out $TMP/avx2.out; then
+         echo -e "Round $round $flag: ${RED}outputs differ${NC}"
+         failed=1
+      fi
+   done
+done
+
+if [ $failed = 0 ]; then
+   echo -e "${GREEN}All $rounds rounds matched${NC}"
+fi
+rm -r $TMP
+exit $failed
@@ -0,0 +1,99 @@
+// Checks the hit and miss counters of a pair cache shared by a queue and its
+// clone and snapshot, and that the cache is emptied once a queue using it adds
+// a friendship measure or updates either threshold, on both backends. The
+// measures are always neutral, so every element is compared on every enqueue.
+// Usage: pairCacheTest
+
+#include "IsraeliQueue.c"
+
+#define ITEMS 6
+
+int items[ITEMS];
+long long measureCalls = 0;
+
+int countedNeutral(void* first, void* second) {
+    measureCalls++;
+    return 0;
+}
+
+int otherCountedNeutral(void* first, void* second) {
+    measureCalls++;
+    return 0;
+}
+
+// Enqueues the item and checks how many lookups the cache answered and could
+// not answer meanwhile, and that the measures were only called on misses.
+bool enqueueExpecting(IsraeliQueue q, int item, long long hits, long long misses, const char* step) {
+    long long hitsBefore, missesBefore, hitsAfter, missesAfter;
+    long long callsBefore = measureCalls;
+    IsraeliQueuePairCacheGetStats(q->m_pairCache, &hitsBefore, &missesBefore);
+    IsraeliQueueEnqueue(q, &items[item]);
+    IsraeliQueuePairCacheGetStats(q->m_pairCache, &hitsAfter, &missesAfter);
+
+    if (hitsAfter - hitsBefore != hits || missesAfter - missesBefore != misses ||
+        measureCalls - callsBefore != misses * q->m_friendshipsLength) {
+        printf("%s on the %s backend: %lld hits, %lld misses, %lld calls, expected %lld hits, %lld misses\n",
+               step, q->m_backend == ISRAELIQUEUE_ARRAY ? "array" : "linked list", hitsAfter - hitsBefore,
+               missesAfter - missesBefore, measureCalls - callsBefore, hits, misses);
+        return false;
+    }
+    return true;
+}
+
+bool testBackend(IsraeliQueueBackend backend) {
+    FriendshipFunction friendships[2] = { countedNeutral, NULL };
+    IsraeliQueue q = IsraeliQueueCreateWithBackend(friendships, NULL, 10, 0, backend);
+    IsraeliQueuePairCache cache = IsraeliQueuePairCacheCreate();
+    if (!q || !cache || IsraeliQueueSetPairCache(q, cache) != ISRAELIQUEUE_SUCCESS) {
+        return false;
+    }
+    IsraeliQueuePairCacheDestroy(cache);
+
+    // Every pair is new: 0, 1, 2 and 3 lookups.
+    bool passed = true;
+    for (int i = 0; i < 4; i++) {
+        passed = enqueueExpecting(q, i, 0, i, "filling") && passed;
+    }
+
+    // Copies share the cache, so they find what the queue looked up.
+    IsraeliQueue clone = IsraeliQueueClone(q);
+    IsraeliQueue snapshot = IsraeliQueueSnapshot(q);
+    if (!clone || !snapshot || clone->m_pairCache != cache || snapshot->m_pairCache != cache) {
+        printf("Copies on the %s backend do not share the cache\n",
+               backend == ISRAELIQUEUE_ARRAY ? "array" : "linked list");
+        return false;
+    }
+    passed = enqueueExpecting(q, 4, 0, 4, "new item") && passed;
+    passed = enqueueExpecting(clone, 4, 4, 0, "clone") && passed;
+    passed = enqueueExpecting(snapshot, 4, 4, 0, "snapshot") && passed;
+
+    // Enqueuing 4 again into the clone looks up its 5 pairs with 0 to 4, only
+    // one of which is new, and then each copy of 4 added since again.
+    passed = enqueueExpecting(clone, 4, 4, 1, "repeated item") && passed;
+    IsraeliQueueUpdateFriendshipThreshold(clone, 11);
+    passed = enqueueExpecting(clone, 4, 1, 5, "friendship threshold update") && passed;
+    IsraeliQueueUpdateRivalryThreshold(clone, 1);
+    passed = enqueueExpecting(clone, 4, 2, 5, "rivalry threshold update") && passed;
+    IsraeliQueueAddFriendshipMeasure(clone, otherCountedNeutral);
+    passed = enqueueExpecting(clone, 4, 3, 5, "added measure") && passed;
+    passed = enqueueExpecting(clone, 4, 9, 0, "unchanged queue") && passed;
+
+    // The queue still has the old measures and thresholds, so the cache is
+    // emptied again before 4 is looked up against 0 to 4.
+    passed = enqueueExpecting(q, 4, 0, 5, "queue with other measures") && passed;
+
+    IsraeliQueueDestroy(snapshot);
+    IsraeliQueueDestroy(clone);
+    IsraeliQueueDestroy(q);
+    return passed;
+}
+
+int main(void) {
+    for (int i = 0; i < ITEMS; i++) {
+        items[i] = i;
+    }
+
+    bool passed = testBackend(ISRAELIQUEUE_LINKED_LIST);
+    passed = testBackend(ISRAELIQUEUE_ARRAY) && passed;
+    return passed ? 0 : 1;
+}
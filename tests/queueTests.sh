@@ -0,0 +1,29 @@
+#!/bin/bash
+
+# Builds and runs every tests/*Test.c driver. Each driver includes the code it
+# tests, so it can check internal state, and exits with a nonzero status on
+# failure.
+# Usage: tests/queueTests.sh, from the repository's root.
+
+GREEN='\033[0;32m'
+RED='\033[0;31m'
+NC='\033[0m' # No Color
+TMP=$(mktemp -d)
+failed=0
+
+for driver in tests/*Test.c; do
+   name=$(basename $driver .c)
+   if ! gcc -O2 -std=c99 -pthread -I. -Itool -Wall -pedantic-errors -Werror -DNDEBUG \
+         $driver -lm -o $TMP/$name; then
+      echo -e "$name: ${RED}failed to build${NC}"
+      failed=1
+   elif ! $TMP/$name; then
+      echo -e "$name: ${RED}failed${NC}"
+      failed=1
+   else
+      echo -e "$name: ${GREEN}passed${NC}"
+   fi
+done
+
+rm -r $TMP
+exit $failed
@@ -0,0 +1,128 @@
+// Checks that IsraeliQueueSize matches a full walk of the queue after every
+// mutating call, for both backends, over random sequences of calls. Includes
+// the queue's implementation to walk its list and arrays directly.
+// Usage: sizeTest [rounds]
+
+#include "IsraeliQueue.c"
+
+#define DEFAULT_ROUNDS 200
+#define STEPS 300
+#define ITEMS 64
+
+int items[ITEMS];
+int failures = 0;
+
+int closeItems(void* first, void* second) {
+    int difference = *(int*)first - *(int*)second;
+    return difference < 0 ? difference + 8 : 8 - difference;
+}
+
+int walkSize(IsraeliQueue q) {
+    int size = 0;
+    if (q->m_backend == ISRAELIQUEUE_ARRAY) {
+        for (int i = q->m_head; i < q->m_gapStart; i++) {
+            size++;
+        }
+        for (int i = q->m_gapEnd; i < q->m_capacity; i++) {
+            size++;
+        }
+        return size;
+    }
+
+    Node last = NULL;
+    for (Node node = q->m_list; node; node = node->m_next) {
+        last = node;
+        size++;
+    }
+    if (last != q->m_tail) {
+        return -1;
+    }
+    return size;
+}
+
+void check(IsraeliQueue q, int round, const char* call) {
+    int walked = walkSize(q);
+    if (IsraeliQueueSize(q) != walked) {
+        printf("Round %d, after %s: size %d, walked %d\n", round, call, IsraeliQueueSize(q), walked);
+        failures++;
+    }
+}
+
+IsraeliQueue create(IsraeliQueueBackend backend) {
+    FriendshipFunction friendships[2] = { closeItems, NULL };
+    return IsraeliQueueCreateWithBackend(friendships, NULL, 4, -4, backend);
+}
+
+void runRound(int round, IsraeliQueueBackend backend) {
+    IsraeliQueue q = create(backend);
+    if (!q) {
+        failures++;
+        return;
+    }
+    check(q, round, "IsraeliQueueCreate");
+
+    for (int step = 0; step < STEPS; step++) {
+        switch (rand() % 8) {
+        case 0:
+        case 1:
+        case 2: {
+            IsraeliQueueEnqueue(q, &items[rand() % ITEMS]);
+            check(q, round, "IsraeliQueueEnqueue");
+            break;
+        }
+        case 3: {
+            void* many[8];
+            int n = rand() % 8;
+            for (int i = 0; i < n; i++) {
+                many[i] = &items[rand() % ITEMS];
+            }
+            IsraeliQueueEnqueueMany(q, many, n);
+            check(q, round, "IsraeliQueueEnqueueMany");
+            break;
+        }
+        case 4:
+        case 5: {
+            IsraeliQueueDequeue(q);
+            check(q, round, "IsraeliQueueDequeue");
+            break;
+        }
+        case 6: {
+            IsraeliQueue clone = IsraeliQueueClone(q);
+            check(clone, round, "IsraeliQueueClone");
+            IsraeliQueueDestroy(q);
+            q = clone;
+            break;
+        }
+        default: {
+            IsraeliQueueImprovePositions(q);
+            check(q, round, "IsraeliQueueImprovePositions");
+            break;
+        }
+        }
+    }
+
+    IsraeliQueue other = create(backend);
+    IsraeliQueueEnqueue(other, &items[0]);
+    IsraeliQueue queues[3] = { q, other, NULL };
+    IsraeliQueue merged = IsraeliQueueMerge(queues, NULL);
+    check(q, round, "IsraeliQueueMerge");
+    check(other, round, "IsraeliQueueMerge");
+    check(merged, round, "IsraeliQueueMerge");
+
+    IsraeliQueueDestroy(merged);
+    IsraeliQueueDestroy(other);
+    IsraeliQueueDestroy(q);
+}
+
+int main(int argc, char* argv[]) {
+    int rounds = argc > 1 ? atoi(argv[1]) : DEFAULT_ROUNDS;
+    for (int i = 0; i < ITEMS; i++) {
+        items[i] = i;
+    }
+
+    srand(1);
+    for (int round = 0; round < rounds; round++) {
+        runRound(round, round % 2 ? ISRAELIQUEUE_ARRAY : ISRAELIQUEUE_LINKED_LIST);
+    }
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,87 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+
+#include "IsraeliQueue.h"
+
+// Takes copies of one array backed queue, with IsraeliQueueClone or with
+// IsraeliQueueSnapshot, then dequeues from every copy and enqueues into a few
+// of them, reporting the time and the memory each step took.
+// Usage: snapshotBench <clone|snapshot> [queue size] [copies]
+
+#define DEFAULT_QUEUE_SIZE 100000
+#define DEFAULT_COPIES 1000
+#define DEQUEUES_PER_COPY 10
+#define COPIES_ENQUEUED_INTO 10
+
+double now(void) {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+// Peak resident memory of the process so far, in MB.
+double peakMemory(void) {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss / 1024.0;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2 || (strcmp(argv[1], "clone") != 0 && strcmp(argv[1], "snapshot") != 0)) {
+        printf("Usage: %s <clone|snapshot> [queue size] [copies]\n", argv[0]);
+        return 1;
+    }
+    bool snapshot = strcmp(argv[1], "snapshot") == 0;
+    int size = argc > 2 ? atoi(argv[2]) : DEFAULT_QUEUE_SIZE;
+    int copies = argc > 3 ? atoi(argv[3]) : DEFAULT_COPIES;
+
+    FriendshipFunction friendships[1] = { NULL };
+    IsraeliQueue queue = IsraeliQueueCreateWithBackend(friendships, NULL, 0, 0, ISRAELIQUEUE_ARRAY);
+    int* items = malloc(sizeof(int) * size);
+    IsraeliQueue* queues = malloc(sizeof(IsraeliQueue) * copies);
+    if (!queue || !items || !queues) {
+        return 1;
+    }
+    for (int i = 0; i < size; i++) {
+        items[i] = i;
+        IsraeliQueueEnqueue(queue, &items[i]);
+    }
+    double memory = peakMemory();
+
+    double start = now();
+    for (int i = 0; i < copies; i++) {
+        queues[i] = snapshot ? IsraeliQueueSnapshot(queue) : IsraeliQueueClone(queue);
+        if (!queues[i]) {
+            return 1;
+        }
+    }
+    double copySeconds = now() - start;
+    double copyMemory = peakMemory() - memory;
+
+    start = now();
+    for (int i = 0; i < copies; i++) {
+        for (int j = 0; j < DEQUEUES_PER_COPY; j++) {
+            IsraeliQueueDequeue(queues[i]);
+        }
+    }
+    for (int i = 0; i < copies && i < COPIES_ENQUEUED_INTO; i++) {
+        IsraeliQueueEnqueue(queues[i], &items[0]);
+    }
+    double mutateSeconds = now() - start;
+    double mutateMemory = peakMemory() - memory;
+
+    printf("%s\t%.3f\t%.1f\t%.3f\t%.1f\n", argv[1], copySeconds, copyMemory, mutateSeconds, mutateMemory);
+
+    for (int i = 0; i < copies; i++) {
+        IsraeliQueueDestroy(queues[i]);
+    }
+    IsraeliQueueDestroy(queue);
+    free(queues);
+    free(items);
+    return 0;
+}
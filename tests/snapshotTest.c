@@ -0,0 +1,134 @@
+// Checks that a snapshot and the queue it was taken of do not see each other's
+// changes: after an enqueue, IsraeliQueueImprovePositions, a dequeue and
+// another enqueue on one of them, the other still holds the same elements with
+// the same friend and rival counters. Runs the steps from each of them in turn,
+// so every one is the first to write to shared arrays, changing the queue and
+// then the snapshot, for both backends.
+// Usage: snapshotTest
+
+#include "IsraeliQueue.c"
+
+#define ITEMS 40
+#define ENQUEUED 30
+
+int items[ITEMS];
+
+// Friends when close, rivals when far, neutral in between.
+int distance(void* first, void* second) {
+    int difference = abs(*(int*)first - *(int*)second);
+    return difference < 4 ? 20 : difference > 30 ? -20 : 0;
+}
+
+// The elements of a queue in order with their counters.
+typedef struct Contents {
+    void* m_items[ITEMS];
+    int m_friendsCalledOver[ITEMS];
+    int m_rivalsBlocked[ITEMS];
+    int m_size;
+} Contents;
+
+Contents contentsOf(IsraeliQueue q) {
+    Contents contents = { { NULL }, { 0 }, { 0 }, IsraeliQueueSize(q) };
+    IsraeliQueueCursor cursor = IsraeliQueueBegin(q);
+    for (int i = 0; i < contents.m_size; i++) {
+        if (q->m_backend == ISRAELIQUEUE_ARRAY) {
+            contents.m_friendsCalledOver[i] = q->m_itemsFriendsCalledOver[cursor.m_physical];
+            contents.m_rivalsBlocked[i] = q->m_itemsRivalsBlocked[cursor.m_physical];
+        } else {
+            contents.m_friendsCalledOver[i] = ((Node)cursor.m_node)->m_friendsCalledOver;
+            contents.m_rivalsBlocked[i] = ((Node)cursor.m_node)->m_rivalsBlocked;
+        }
+        contents.m_items[i] = IsraeliQueueCursorNext(&cursor);
+    }
+    return contents;
+}
+
+bool sameContents(Contents first, Contents second) {
+    if (first.m_size != second.m_size) {
+        return false;
+    }
+    for (int i = 0; i < first.m_size; i++) {
+        if (first.m_items[i] != second.m_items[i] || first.m_friendsCalledOver[i] != second.m_friendsCalledOver[i] ||
+            first.m_rivalsBlocked[i] != second.m_rivalsBlocked[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Changes the queue from the given step on, checking after each step that the
+// other one is untouched.
+bool changeAndCheck(IsraeliQueue changed, IsraeliQueue other, int first, const char* name) {
+    Contents before = contentsOf(other);
+    const char* steps[] = { "enqueue", "IsraeliQueueImprovePositions", "dequeue", "enqueue again" };
+    bool passed = true;
+    for (int i = 0; i < 4; i++) {
+        int step = (first + i) % 4;
+        if (step == 0 || step == 3) {
+            IsraeliQueueEnqueue(changed, &items[ENQUEUED + step]);
+        } else if (step == 1) {
+            IsraeliQueueImprovePositions(changed);
+        } else {
+            IsraeliQueueDequeue(changed);
+        }
+
+        if (!sameContents(before, contentsOf(other))) {
+            printf("%s: the other queue changed after the %s\n", name, steps[step]);
+            passed = false;
+        }
+    }
+
+    if (sameContents(before, contentsOf(changed))) {
+        printf("%s: the changed queue did not change\n", name);
+        passed = false;
+    }
+    return passed;
+}
+
+bool testBackend(IsraeliQueueBackend backend, bool changeSnapshot, int first) {
+    char name[96];
+    sprintf(name, "%s, changing the %s from step %d", backend == ISRAELIQUEUE_ARRAY ? "array" : "linked list",
+            changeSnapshot ? "snapshot" : "queue", first);
+
+    FriendshipFunction friendships[2] = { distance, NULL };
+    IsraeliQueue q = IsraeliQueueCreateWithBackend(friendships, NULL, 10, 0, backend);
+    if (!q) {
+        return false;
+    }
+    for (int i = 0; i < ENQUEUED; i++) {
+        IsraeliQueueEnqueue(q, &items[rand() % ITEMS]);
+    }
+
+    // Dequeue from the queue first, so the shared arrays start past their head.
+    IsraeliQueueDequeue(q);
+    IsraeliQueue snapshot = IsraeliQueueSnapshot(q);
+    if (!snapshot) {
+        return false;
+    }
+    if (backend == ISRAELIQUEUE_ARRAY && snapshot->m_items != q->m_items) {
+        printf("%s: the snapshot does not share the queue's arrays\n", name);
+        return false;
+    }
+
+    bool passed = changeSnapshot ? changeAndCheck(snapshot, q, first, name)
+                                 : changeAndCheck(q, snapshot, first, name);
+    IsraeliQueueDestroy(snapshot);
+    IsraeliQueueDestroy(q);
+    return passed;
+}
+
+int main(void) {
+    for (int i = 0; i < ITEMS; i++) {
+        items[i] = i;
+    }
+
+    srand(1);
+    bool passed = true;
+    for (int backend = 0; backend < 2; backend++) {
+        for (int first = 0; first < 4; first++) {
+            passed = testBackend(backend, false, first) && passed;
+            passed = testBackend(backend, true, first) && passed;
+        }
+    }
+    return passed ? 0 : 1;
+}
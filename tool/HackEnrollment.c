@@ -1,113 +1,493 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include "HackEnrollment.h"
 
 #include <stdbool.h>
 #include <assert.h>
+#include <pthread.h>
+#include <ctype.h>
+#include <limits.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// SSE2 is always there on x86-64, while AVX2 is picked at runtime.
+#if !defined(HACKENROLLMENT_NO_SIMD) && defined(__SSE2__)
+#define HACKENROLLMENT_SSE2
+#include <emmintrin.h>
+#if !defined(HACKENROLLMENT_NO_AVX2) && defined(__GNUC__) && defined(__x86_64__)
+#define HACKENROLLMENT_AVX2
+#include <immintrin.h>
+#endif
+#endif
 
 #define SPACE_CHAR ' '
+#define STUDENT_INDEX_MIN_CAPACITY 16
+#define LINE_READER_BLOCK (1 << 16)
+#define TEXT_BLOCK_SIZE (1 << 16)
+#define TEXT_INTERNED_MIN_CAPACITY 16
+#define OUTPUT_WRITER_BLOCK (1 << 16)
+
+// The friendship measures each course queue is given, and scoreStudents fuses.
+#define STUDENT_MEASURES 3
 
 #define MAX(X, Y) (((X) > (Y)) ? (X) : (Y))
+#define MIN(X, Y) (((X) < (Y)) ? (X) : (Y))
+
+typedef int (*NamesDiffKernel)(const unsigned char*, const unsigned char*);
+
+// Moves a view past its first count characters.
+void skipChars(StringView* view, int count)
+{
+    view->m_data += count;
+    view->m_length -= count;
+}
 
 //counts elements using space amount
-int countElementsInLine(char* line)
+int countElementsInLine(StringView line)
 {
-    if (strcmp(line, "") == 0) {
+    if (line.m_length == 0) {
         return 0;
     }
 
     int elementAmount = 1;
-    while(*line)
+    for(int i = 0; i < line.m_length; i++)
     {
-        if(SPACE_CHAR == *line)
+        if(SPACE_CHAR == line.m_data[i])
         {
             // If this is the last character, don't count it.
-            if (*(line + 1) == '\0') {
+            if (i + 1 == line.m_length) {
                 return elementAmount;
             }
 
             elementAmount++;
         }
-        line++;
     }
 
     return elementAmount;
 }
 
-// Reads a line of an unbounded length.
-char* readLine(FILE* input) {
-    char* line = NULL;
-    char* lineNew = NULL;
-    int lineLength = 0;
-    int lineCapacity = 0;
-    int character = 0;
+// Reads a file's lines, either out of a buffer that is filled in large blocks,
+// or straight out of the file mapped to memory, in which case m_file is NULL.
+// Like the files' format, every '\n' ends a line, and whatever follows the last
+// one, even nothing, is one more line.
+typedef struct LineReader {
+    FILE* m_file;
+    char* m_buffer;
+    size_t m_capacity;
+    size_t m_start;
+    size_t m_end;
+    bool m_lastLineRead;
+    bool m_failed;
+} LineReader;
+
+void initLineReader(LineReader* reader, FILE* file) {
+    reader->m_file = file;
+    reader->m_buffer = NULL;
+    reader->m_capacity = 0;
+    reader->m_start = 0;
+    reader->m_end = 0;
+    reader->m_lastLineRead = false;
+    reader->m_failed = false;
+}
 
-    if (feof(input)) {
-        return NULL;
+void initMappedLineReader(LineReader* reader, char* data, size_t size) {
+    initLineReader(reader, NULL);
+    reader->m_buffer = data;
+    reader->m_capacity = size;
+    reader->m_end = size;
+}
+
+void destroyLineReader(LineReader* reader) {
+    // A mapped file is unmapped by whoever mapped it.
+    if (reader->m_file) {
+        free(reader->m_buffer);
     }
+    reader->m_buffer = NULL;
+}
 
-    for(character = fgetc(input); character != '\n' && character != EOF; character = fgetc(input)) {
-        // Allocate space if needed.
-        if (lineLength == lineCapacity) {
-            lineCapacity = MAX(lineCapacity * 2, 16);
-            lineNew = realloc(line, (lineCapacity + 1) * sizeof(char));
-            if (lineNew == NULL) {
-                free(line);
-                return NULL;
-            }
-            line = lineNew;
+// Reads another block into the buffer, after moving the unread data to its
+// start and growing it if that data fills it. Returns false at the end of the
+// file or on failure.
+bool fillLineReader(LineReader* reader) {
+    size_t unread = reader->m_end - reader->m_start;
+    size_t read = 0;
+
+    if (reader->m_file == NULL) {
+        return false;
+    }
+
+    if (unread > 0) {
+        memmove(reader->m_buffer, reader->m_buffer + reader->m_start, unread);
+    }
+    reader->m_start = 0;
+    reader->m_end = unread;
+
+    if (reader->m_capacity - unread < LINE_READER_BLOCK) {
+        size_t capacity = MAX(reader->m_capacity * 2, unread + LINE_READER_BLOCK);
+        char* buffer = realloc(reader->m_buffer, capacity);
+        if (buffer == NULL) {
+            reader->m_failed = true;
+            return false;
         }
+        reader->m_buffer = buffer;
+        reader->m_capacity = capacity;
+    }
+
+    if (feof(reader->m_file) || ferror(reader->m_file)) {
+        return false;
+    }
+
+    read = fread(reader->m_buffer + unread, 1, reader->m_capacity - unread, reader->m_file);
+    reader->m_end += read;
+    return read > 0;
+}
+
+// Fills lines with the next count lines. They stay valid until the next call,
+// or as long as the mapped file for a mapped reader. Returns false, reading
+// nothing, if fewer lines are left.
+bool readLines(LineReader* reader, StringView* lines, int count) {
+    int found = 0;
+    size_t position = reader->m_start;
 
-        line[lineLength] = character;
-        lineLength++;
+    if (reader->m_lastLineRead || reader->m_failed) {
+        return false;
     }
 
-    // Trim the string.
-    lineNew = realloc(line, (lineLength + 1) * sizeof(char));
-    if (lineNew == NULL) {
-        free(line);
+    while (found < count) {
+        char* newLine = position < reader->m_end
+            ? memchr(reader->m_buffer + position, '\n', reader->m_end - position)
+            : NULL;
+        if (newLine) {
+            position = newLine - reader->m_buffer + 1;
+            found++;
+            continue;
+        }
+
+        // Filling moves the unread data to the start of the buffer.
+        size_t scanned = position - reader->m_start;
+        bool filled = fillLineReader(reader);
+        position = reader->m_start + scanned;
+        if (!filled) {
+            break;
+        }
+    }
+
+    if (reader->m_failed) {
+        return false;
+    }
+
+    // The end of the file ends the last line.
+    if (found + 1 == count) {
+        reader->m_lastLineRead = true;
+        found++;
+    }
+
+    if (found < count) {
+        return false;
+    }
+
+    for (int i = 0; i < count; i++) {
+        char* start = reader->m_buffer + reader->m_start;
+        char* end = memchr(start, '\n', reader->m_end - reader->m_start);
+        if (!end) {
+            end = reader->m_buffer + reader->m_end;
+        }
+
+        lines[i].m_data = start;
+        lines[i].m_length = end - start;
+        reader->m_start = end - reader->m_buffer + 1;
+    }
+
+    return true;
+}
+
+// Maps a file to memory, read only. Returns NULL if it can't be mapped, such
+// as when it isn't a regular file.
+char* mapFile(FILE* file, size_t* size) {
+    static char emptyFile[1] = { 0 };
+    struct stat status;
+    void* data = NULL;
+    int descriptor = fileno(file);
+
+    if (descriptor < 0 || fstat(descriptor, &status) != 0 || !S_ISREG(status.st_mode)) {
         return NULL;
     }
-    line = lineNew;
 
-    // Terminate the string.
-    line[lineLength] = '\0';
+    // Empty files can't be mapped, but have nothing to map either.
+    *size = status.st_size;
+    if (*size == 0) {
+        return emptyFile;
+    }
 
-    return line;
+    data = mmap(NULL, *size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+    return data == MAP_FAILED ? NULL : (char*)data;
 }
 
-//helper functions
-int getLineNum(FILE* file)
+void unmapFile(char* data, size_t size) {
+    if (data && size > 0) {
+        munmap(data, size);
+    }
+}
+
+// Cuts the next whitespace separated token off a line, like sscanf's %s.
+// Returns false if there is none.
+bool nextToken(StringView* line, StringView* token) {
+    int start = 0;
+    int end = 0;
+
+    while (start < line->m_length && isspace((unsigned char)line->m_data[start])) {
+        start++;
+    }
+    if (start == line->m_length) {
+        skipChars(line, start);
+        return false;
+    }
+
+    for (end = start; end < line->m_length && !isspace((unsigned char)line->m_data[end]); end++);
+    token->m_data = line->m_data + start;
+    token->m_length = end - start;
+    skipChars(line, end);
+    return true;
+}
+
+// Reads the next integer off a line, like sscanf's %d, which converts like
+// strtol. Leaves out untouched and returns false if there is none.
+bool nextInt(StringView* line, int* out) {
+    // Past this, the value is out of long's range whatever its sign, so it
+    // stops growing.
+    const unsigned long long saturated = (unsigned long long)LONG_MAX + 2;
+    unsigned long long value = 0;
+    bool negative = false;
+    long result = 0;
+    int i = 0;
+    int digits = 0;
+
+    while (i < line->m_length && isspace((unsigned char)line->m_data[i])) {
+        i++;
+    }
+    if (i < line->m_length && (line->m_data[i] == '-' || line->m_data[i] == '+')) {
+        negative = line->m_data[i] == '-';
+        i++;
+    }
+    for (digits = i; i < line->m_length && isdigit((unsigned char)line->m_data[i]); i++) {
+        value = value > saturated / 10 ? saturated : MIN(value * 10 + (line->m_data[i] - '0'), saturated);
+    }
+    if (i == digits) {
+        return false;
+    }
+
+    if (negative) {
+        result = value > (unsigned long long)LONG_MAX ? LONG_MIN : -(long)value;
+    } else {
+        result = value > (unsigned long long)LONG_MAX ? LONG_MAX : (long)value;
+    }
+
+    *out = (int)result;
+    skipChars(line, i);
+    return true;
+}
+
+// Copies the next token of a line to an id buffer, leaving it untouched if
+// there is none.
+bool nextID(StringView* line, char ID[ID_SIZE + 1]) {
+    StringView token;
+    if (!nextToken(line, &token)) {
+        return false;
+    }
+
+    memcpy(ID, token.m_data, MIN(token.m_length, ID_SIZE));
+    ID[MIN(token.m_length, ID_SIZE)] = '\0';
+    return true;
+}
+
+// Copies the ID_SIZE characters at an offset of a line to an id buffer, or
+// fewer if the line ends before.
+void copyIDAt(StringView line, int offset, char ID[ID_SIZE + 1]) {
+    int length = MIN(MAX(line.m_length - offset, 0), ID_SIZE);
+
+    memset(ID, 0, ID_SIZE + 1);
+    if (length > 0) {
+        memcpy(ID, line.m_data + offset, length);
+    }
+}
+
+// Makes room for one more element in a growable array.
+bool growArray(void** array, int size, int* capacity, size_t elementSize) {
+    void* arrayNew = NULL;
+
+    if (size < *capacity) {
+        return true;
+    }
+
+    arrayNew = realloc(*array, elementSize * MAX(*capacity * 2, 16));
+    if (arrayNew == NULL) {
+        return false;
+    }
+
+    *array = arrayNew;
+    *capacity = MAX(*capacity * 2, 16);
+    return true;
+}
+
+// A block of a text arena, that strings are bump allocated from.
+typedef struct TextBlock {
+    struct TextBlock* m_next;
+    size_t m_size;
+    size_t m_used;
+    char m_data[];
+} TextBlock;
+
+// Owns the students' text. Strings are bump allocated from blocks, and interned
+// strings are also kept in an open addressing table, so repeating ones are
+// stored once.
+struct TextArena_t {
+    TextBlock* m_blocks;
+    StringView* m_interned;
+    int m_internedSize;
+    int m_internedCapacity;
+};
+
+TextArena createTextArena(void)
+{
+    TextArena arena = (TextArena)malloc(sizeof(struct TextArena_t));
+    if (!arena) {
+        return NULL;
+    }
+
+    arena->m_blocks = NULL;
+    arena->m_interned = NULL;
+    arena->m_internedSize = 0;
+    arena->m_internedCapacity = 0;
+    return arena;
+}
+
+void destroyTextArena(TextArena arena)
 {
-    int lineNum = 0;
-    char* line = NULL;
+    if (!arena) {
+        return;
+    }
+
+    while (arena->m_blocks) {
+        TextBlock* next = arena->m_blocks->m_next;
+        free(arena->m_blocks);
+        arena->m_blocks = next;
+    }
+    free(arena->m_interned);
+    free(arena);
+}
+
+// Copies a view into the arena as a null terminated string, and returns a view
+// of the copy. Its data is NULL if allocation fails.
+StringView textArenaCopy(TextArena arena, StringView view)
+{
+    StringView out = { NULL, view.m_length };
+    size_t size = view.m_length + 1;
+    TextBlock* block = arena->m_blocks;
+
+    if (!block || block->m_size - block->m_used < size) {
+        size_t blockSize = MAX(size, TEXT_BLOCK_SIZE);
+        block = (TextBlock*)malloc(sizeof(TextBlock) + blockSize);
+        if (!block) {
+            return out;
+        }
+        block->m_next = arena->m_blocks;
+        block->m_size = blockSize;
+        block->m_used = 0;
+        arena->m_blocks = block;
+    }
+
+    char* data = block->m_data + block->m_used;
+    memcpy(data, view.m_data, view.m_length);
+    data[view.m_length] = '\0';
+    block->m_used += size;
+    out.m_data = data;
+    return out;
+}
 
-    while((line = readLine(file)))
+//FNV-1a hash of a string's characters
+unsigned int hashText(const char* text, int length)
+{
+    unsigned int hash = 2166136261u;
+    for(int i = 0; i < length; i++)
     {
-        lineNum++;
-        free(line);
+        hash = (hash ^ (unsigned char)text[i]) * 16777619u;
     }
 
-    // Push the file pointer back to the start of the file.
-    fseek(file, 0, SEEK_SET);
+    return hash;
+}
 
-    return lineNum;
+// Finds the slot of an interned string in the table, or the empty slot it
+// would go to.
+int textArenaFind(TextArena arena, StringView view)
+{
+    int mask = arena->m_internedCapacity - 1;
+    int slot = hashText(view.m_data, view.m_length) & mask;
+
+    for (; arena->m_interned[slot].m_data; slot = (slot + 1) & mask) {
+        StringView interned = arena->m_interned[slot];
+        if (interned.m_length == view.m_length &&
+            memcmp(interned.m_data, view.m_data, view.m_length) == 0) {
+            break;
+        }
+    }
+
+    return slot;
 }
 
-//Frees up memory associated with a student.
+// Doubles the interning table, keeping it at most half full.
+bool textArenaGrow(TextArena arena)
+{
+    StringView* old = arena->m_interned;
+    int oldCapacity = arena->m_internedCapacity;
+    int capacity = MAX(oldCapacity * 2, TEXT_INTERNED_MIN_CAPACITY);
+
+    arena->m_interned = (StringView*)calloc(capacity, sizeof(StringView));
+    if (!arena->m_interned) {
+        arena->m_interned = old;
+        return false;
+    }
+    arena->m_internedCapacity = capacity;
+
+    for (int i = 0; i < oldCapacity; i++) {
+        if (old[i].m_data) {
+            arena->m_interned[textArenaFind(arena, old[i])] = old[i];
+        }
+    }
+
+    free(old);
+    return true;
+}
+
+// Like textArenaCopy, but returns the earlier copy of an equal interned string
+// if there is one.
+StringView textArenaIntern(TextArena arena, StringView view)
+{
+    StringView out = { NULL, view.m_length };
+    int slot = 0;
+
+    if (2 * (arena->m_internedSize + 1) > arena->m_internedCapacity && !textArenaGrow(arena)) {
+        return out;
+    }
+
+    slot = textArenaFind(arena, view);
+    if (!arena->m_interned[slot].m_data) {
+        out = textArenaCopy(arena, view);
+        if (!out.m_data) {
+            return out;
+        }
+        arena->m_interned[slot] = out;
+        arena->m_internedSize++;
+    }
+
+    return arena->m_interned[slot];
+}
+
+//Frees up memory associated with a student. Its text belongs to the system's arena, or to
+//the mapped students file.
 void destroyStudent(Student student) {
     if (student == NULL) {
         return;
     }
-    
-    free(student->m_name);
-    free(student->m_surname);
-    free(student->m_city);
-    free(student->m_department);
-
-    // It's good practice to NULL dangling pointers.
-    student->m_name = NULL;
-    student->m_surname = NULL;
-    student->m_city = NULL;
-    student->m_department = NULL;
 
     free(student);
 }
@@ -121,10 +501,14 @@ void destroyHacker(Hacker hacker) {
     free(hacker->m_courses);
     free(hacker->m_friends);
     free(hacker->m_rivals);
+    free(hacker->m_friendIndices);
+    free(hacker->m_rivalIndices);
 
     hacker->m_courses = NULL;
     hacker->m_friends = NULL;
     hacker->m_rivals = NULL;
+    hacker->m_friendIndices = NULL;
+    hacker->m_rivalIndices = NULL;
 
     free(hacker);
 }
@@ -147,47 +531,117 @@ void destroyCourse(Course course) {
     free(course);
 }
 
+//orders courses by number, and courses with the same number by file order
+int compareCourses(const void* a, const void* b)
+{
+    Course first = *(const Course*)a;
+    Course second = *(const Course*)b;
+
+    if(first->m_number != second->m_number)
+    {
+        return first->m_number < second->m_number ? -1 : 1;
+    }
+
+    return first->m_index - second->m_index;
+}
+
 //returns a course pointer based on the course number
 Course getCourseFromNum(EnrollmentSystem sys, int courseNum)
 {
-    for(int i = 0; i < sys->m_coursesSize; i++)
+    // Binary search for the first course with the number in the sorted index,
+    // which is the first one in the file when numbers repeat.
+    int low = 0;
+    int high = sys->m_coursesSize;
+    while(low < high)
     {
-        if(sys->m_courses[i]->m_number == courseNum)
+        int middle = low + (high - low) / 2;
+        if(sys->m_courseIndex[middle]->m_number < courseNum)
+        {
+            low = middle + 1;
+        }
+        else
         {
-            return sys->m_courses[i];
+            high = middle;
         }
     }
 
+    if(low < sys->m_coursesSize && sys->m_courseIndex[low]->m_number == courseNum)
+    {
+        return sys->m_courseIndex[low];
+    }
+
     return NULL;
 }
 
-//returns a student pointer based on the id
-Student getStudentFromID(EnrollmentSystem sys, char ID[ID_SIZE + 1])
+//FNV-1a hash of an id string
+unsigned int hashID(const char* ID)
 {
-    for(int i = 0; i < sys->m_studentsSize; i++)
+    return hashText(ID, strlen(ID));
+}
+
+//builds an open addressing hash table over the students' ids. When ids repeat
+//only the first student is indexed, the same one a linear scan would find.
+Student* createStudentIndex(Student* students, int size, int* capacity)
+{
+    int indexCapacity = STUDENT_INDEX_MIN_CAPACITY;
+    Student* index = NULL;
+
+    while(indexCapacity < 2 * size)
     {
-        if(strcmp(sys->m_students[i]->m_ID, ID) == 0)
+        indexCapacity *= 2;
+    }
+
+    index = (Student*)calloc(indexCapacity, sizeof(Student));
+    if(!index)
+    {
+        return NULL;
+    }
+
+    for(int i = 0; i < size; i++)
+    {
+        unsigned int slot = hashID(students[i]->m_ID) & (indexCapacity - 1);
+        while(index[slot] && strcmp(index[slot]->m_ID, students[i]->m_ID) != 0)
         {
-            return sys->m_students[i];
+            slot = (slot + 1) & (indexCapacity - 1);
+        }
+
+        if(!index[slot])
+        {
+            index[slot] = students[i];
         }
     }
 
-    return NULL;
+    *capacity = indexCapacity;
+    return index;
 }
 
-char* cloneString(const char* string) {
-    if (string == NULL) {
+//returns a student pointer based on the id
+Student getStudentFromID(EnrollmentSystem sys, char ID[ID_SIZE + 1])
+{
+    if(sys->m_studentIndex)
+    {
+        int mask = sys->m_studentIndexCapacity - 1;
+        unsigned int slot = hashID(ID) & mask;
+        for(; sys->m_studentIndex[slot]; slot = (slot + 1) & mask)
+        {
+            if(strcmp(sys->m_studentIndex[slot]->m_ID, ID) == 0)
+            {
+                return sys->m_studentIndex[slot];
+            }
+        }
+
         return NULL;
     }
 
-    int len = strlen(string);
-    char* out = (char*)malloc(sizeof(char) * (len + 1));
-    if (out == NULL) {
-        return NULL;
+    for(int i = 0; i < sys->m_studentsSize; i++)
+    {
+        if(strcmp(sys->m_students[i]->m_ID, ID) == 0)
+        {
+            return sys->m_students[i];
+        }
     }
 
-    strcpy(out, string);
-    return out;
+    return NULL;
 }
 
 char lowerCaseChar(char character) {
@@ -198,8 +652,89 @@ char lowerCaseConditional(char character, bool lowerCase) {
     return lowerCase ? lowerCaseChar(character) : character;
 }
 
-Student createStudent(char ID[ID_SIZE + 1], int credits, int GPA, char* name,
-                      char* surname, char* city, char* department, Hacker hacker)
+// The vectorized stringDiff works on the students' padded names, which hold
+// ASCII only, already case folded if the system is case insensitive. Case
+// folding keeps ASCII characters non-negative, so the difference against
+// padding is the character itself, just like what the scalar version adds for
+// the part of the longer string past the shorter one. That makes the sum of
+// absolute differences of the padded bytes equal to stringDiff of the name
+// plus stringDiff of the surname.
+
+#if defined(HACKENROLLMENT_SSE2)
+int paddedNamesDiffSSE2(const unsigned char* names1, const unsigned char* names2)
+{
+    __m128i sum = _mm_setzero_si128();
+
+    for (int i = 0; i < 2 * NAME_PAD_SIZE; i += 16) {
+        __m128i characters1 = _mm_loadu_si128((const __m128i*)(names1 + i));
+        __m128i characters2 = _mm_loadu_si128((const __m128i*)(names2 + i));
+        sum = _mm_add_epi64(sum, _mm_sad_epu8(characters1, characters2));
+    }
+
+    return _mm_cvtsi128_si32(sum) + _mm_cvtsi128_si32(_mm_srli_si128(sum, 8));
+}
+#endif
+
+#if defined(HACKENROLLMENT_AVX2)
+// Both padded names fit in one AVX2 register.
+__attribute__((target("avx2")))
+int paddedNamesDiffAVX2(const unsigned char* names1, const unsigned char* names2)
+{
+    __m256i characters1 = _mm256_loadu_si256((const __m256i*)names1);
+    __m256i characters2 = _mm256_loadu_si256((const __m256i*)names2);
+    long long sums[4];
+
+    _mm256_storeu_si256((__m256i*)sums, _mm256_sad_epu8(characters1, characters2));
+    return (int)(sums[0] + sums[1] + sums[2] + sums[3]);
+}
+#endif
+
+// The vectorized stringDiff for padded names, picked for the CPU by
+// selectNamesDiffKernel, or NULL to always use the scalar one.
+NamesDiffKernel namesDiffKernel = NULL;
+pthread_once_t namesDiffKernelSelected = PTHREAD_ONCE_INIT;
+
+void selectNamesDiffKernel(void)
+{
+#if defined(HACKENROLLMENT_AVX2)
+    if (__builtin_cpu_supports("avx2")) {
+        namesDiffKernel = paddedNamesDiffAVX2;
+        return;
+    }
+#endif
+#if defined(HACKENROLLMENT_SSE2)
+    namesDiffKernel = paddedNamesDiffSSE2;
+#endif
+}
+
+// Copies the given name and surname of a student, zero padded, for the
+// vectorized stringDiff, if both fit and hold ASCII only.
+void padStudentNames(Student student, StringView name, StringView surname)
+{
+    StringView names[2] = { name, surname };
+
+    memset(student->m_paddedNames, 0, sizeof(student->m_paddedNames));
+    student->m_hasPaddedNames = false;
+    for (int i = 0; i < 2; i++) {
+        if (names[i].m_length > NAME_PAD_SIZE) {
+            return;
+        }
+        for (int j = 0; j < names[i].m_length; j++) {
+            if ((unsigned char)names[i].m_data[j] > SCHAR_MAX) {
+                return;
+            }
+        }
+        memcpy(student->m_paddedNames + i * NAME_PAD_SIZE, names[i].m_data, names[i].m_length);
+    }
+    student->m_hasPaddedNames = true;
+}
+
+// Creates a student. Its text fields are copied to the arena, interning the city and the
+// department that repeat across students, or point into the given text if the arena is
+// NULL. That text must then outlive the student.
+Student createStudent(int index, char ID[ID_SIZE + 1], int credits, int GPA, StringView name,
+                      StringView surname, StringView city, StringView department,
+                      TextArena arena, Hacker hacker)
  {
     Student out = (Student)malloc(sizeof(struct Student_t));
     if(out == NULL)
@@ -207,20 +742,27 @@ Student createStudent(char ID[ID_SIZE + 1], int credits, int GPA, char* name,
         return NULL;
     }
 
+    out->m_index = index;
     strcpy(out->m_ID, ID);
+    out->m_numericID = atoi(ID);
     out->m_credits = credits;
     out->m_GPA = GPA;
-    out->m_name = cloneString(name);
-    out->m_surname = cloneString(surname);
-    out->m_city = cloneString(city);
-    out->m_department = cloneString(department);
+    out->m_name = arena ? textArenaCopy(arena, name) : name;
+    out->m_surname = arena ? textArenaCopy(arena, surname) : surname;
+    out->m_city = arena ? textArenaIntern(arena, city) : city;
+    out->m_department = arena ? textArenaIntern(arena, department) : department;
     out->m_hacker = hacker;
 
-    if (!out->m_name || !out->m_surname || !out->m_city || !out->m_department) {
+    if (!out->m_name.m_data || !out->m_surname.m_data || !out->m_city.m_data ||
+        !out->m_department.m_data) {
         destroyStudent(out);
-        out = NULL;
+        return NULL;
     }
 
+    out->m_foldedName.m_data = NULL;
+    out->m_foldedName.m_length = 0;
+    out->m_foldedSurname = out->m_foldedName;
+    padStudentNames(out, out->m_name, out->m_surname);
     return out;
 }
 
@@ -230,50 +772,37 @@ void destroyStudentsArray(Student* students, int size) {
     }
 }
 
-//parses the students file and saves the information
-Student* parseStudentsFile(FILE* studentsFile, int* studentsSize)
+//parses the students file and saves the information. The students' text is copied to the
+//arena, or points into the file if the arena is NULL and it is mapped.
+Student* parseStudentsFile(LineReader* reader, TextArena arena, int* studentsSize)
 {
-    bool error = false;
-    char* line = NULL;
+    StringView line;
     char IDBuffer[ID_SIZE + 1] = { 0 };
-    int credits = 0, GPA = 0, i = 0;
-
-    int studentsAmount = getLineNum(studentsFile);
-    Student* students = (Student*)malloc(sizeof(Student) * studentsAmount);
-    if (!students) {
-        return NULL;
-    }
-
-    while((line = readLine(studentsFile))) {
-        int lineLength = strlen(line);
-        char* nameBuffer = (char*)calloc(lineLength + 1, sizeof(char));
-        char* surnameBuffer = (char*)calloc(lineLength + 1, sizeof(char));
-        char* cityBuffer = (char*)calloc(lineLength + 1, sizeof(char));
-        char* departmentBuffer = (char*)calloc(lineLength + 1, sizeof(char));
-        if (!nameBuffer || !surnameBuffer || !cityBuffer || !departmentBuffer) {
-            error = true;
+    int credits = 0, GPA = 0, studentsAmount = 0, capacity = 0;
+    Student* students = NULL;
+
+    while (readLines(reader, &line, 1)) {
+        // Like sscanf, stop at the first missing field. Fields that aren't read
+        // keep the previous line's value, and text fields are left empty.
+        StringView fields[4] = { { "", 0 }, { "", 0 }, { "", 0 }, { "", 0 } };
+        if (nextID(&line, IDBuffer) && nextInt(&line, &credits) && nextInt(&line, &GPA)) {
+            for (int i = 0; i < 4 && nextToken(&line, &fields[i]); i++);
         }
 
-        if (!error) {
-            sscanf(
-                line, "%s %d %d %s %s %s %s",
-                IDBuffer, &credits, &GPA, nameBuffer, surnameBuffer, cityBuffer, departmentBuffer
-            );
-
-            students[i] = createStudent(
-                IDBuffer, credits, GPA, nameBuffer, surnameBuffer, cityBuffer, departmentBuffer, NULL
-            );
-            error = !students[i] ? true : error;
+        if (!growArray((void**)&students, studentsAmount, &capacity, sizeof(Student))) {
+            break;
         }
-
-        i++;
-        free(line);
-        free(nameBuffer);
-        free(surnameBuffer);
-        free(cityBuffer);
-        free(departmentBuffer);
+        students[studentsAmount] = createStudent(
+            studentsAmount, IDBuffer, credits, GPA, fields[0], fields[1], fields[2], fields[3],
+            arena, NULL
+        );
+        if (!students[studentsAmount]) {
+            break;
+        }
+        studentsAmount++;
     }
-    if (error) {
+
+    if (reader->m_failed || !reader->m_lastLineRead) {
         destroyStudentsArray(students, studentsAmount);
         free(students);
         return NULL;
@@ -282,17 +811,39 @@ Student* parseStudentsFile(FILE* studentsFile, int* studentsSize)
     return students;
 }
 
-Course createCourse(int number, int size) {
+// Compares students by their ids, for looking them up in course queues.
+int compareStudentIDs(void* student1, void* student2) {
+    return strcmp(((Student)student1)->m_ID, ((Student)student2)->m_ID);
+}
+
+// Creates an empty course queue that allocates from the given pool, or from a
+// private one if the pool is NULL.
+IsraeliQueue createCourseQueue(IsraeliQueueNodePool pool, IsraeliQueueBackend backend) {
     FriendshipFunction emptyFriendships[1] = { NULL };
 
+    IsraeliQueue queue = IsraeliQueueCreateWithBackend(
+        emptyFriendships, compareStudentIDs, FRIENDSHIP_THRESHOLD, RIVALRY_THRESHOLD, backend
+    );
+    // Array backed queues have no nodes to allocate.
+    if (queue && pool && backend == ISRAELIQUEUE_LINKED_LIST &&
+        IsraeliQueueSetNodePool(queue, pool) != ISRAELIQUEUE_SUCCESS) {
+        IsraeliQueueDestroy(queue);
+        queue = NULL;
+    }
+
+    return queue;
+}
+
+Course createCourse(int index, int number, int size, IsraeliQueueNodePool pool) {
     Course out = (Course)malloc(sizeof(struct Course_t));
     if (!out) {
         return NULL;
     }
 
+    out->m_index = index;
     out->m_number = number;
     out->m_size = size;
-    out->m_queue = IsraeliQueueCreate(emptyFriendships, NULL, FRIENDSHIP_THRESHOLD, RIVALRY_THRESHOLD);
+    out->m_queue = createCourseQueue(pool, ISRAELIQUEUE_LINKED_LIST);
 
     if (!out->m_queue) {
         destroyCourse(out);
@@ -302,40 +853,54 @@ Course createCourse(int number, int size) {
     return out;
 }
 
-//parses the courses file and saves the information
-Course* parseCoursesFile(FILE* coursesFile, int* coursesSize)
+//parses the courses file. Also returns the courses sorted by number through
+//courseIndex, for getCourseFromNum.
+Course* parseCoursesFile(LineReader* reader, IsraeliQueueNodePool pool, int* coursesSize,
+                         Course** courseIndex)
 {
-    char* line = NULL;
-    int i = 0;
-    bool error = false;
+    StringView line;
     int number = 0;
     int size = 0;
+    int coursesAmount = 0;
+    int capacity = 0;
+    Course* courses = NULL;
+    Course* index = NULL;
 
-    int coursesAmount = getLineNum(coursesFile);
-    Course* courses = (Course*)malloc(sizeof(Course) * coursesAmount);
-    if(!courses)
+    while (readLines(reader, &line, 1))
     {
-        return NULL;
-    }
+        // Like sscanf, numbers that aren't read keep the previous line's value.
+        if (nextInt(&line, &number))
+        {
+            nextInt(&line, &size);
+        }
 
-    while((line = readLine(coursesFile)))
-    {
-        sscanf(line, "%d %d", &number, &size);
-        courses[i] = createCourse(number, size);
-        error = !courses[i] ? true : error;
-        i++;
-        free(line);
+        if (!growArray((void**)&courses, coursesAmount, &capacity, sizeof(Course)))
+        {
+            break;
+        }
+        courses[coursesAmount] = createCourse(coursesAmount, number, size, pool);
+        if (!courses[coursesAmount])
+        {
+            break;
+        }
+        coursesAmount++;
     }
 
-    if (error) {
-        for (i = 0; i < coursesAmount; i++) {
+    index = (Course*)malloc(sizeof(Course) * MAX(coursesAmount, 1));
+    if (reader->m_failed || !reader->m_lastLineRead || !index) {
+        for (int i = 0; i < coursesAmount; i++) {
             destroyCourse(courses[i]);
         }
         free(courses);
+        free(index);
         return NULL;
     }
 
+    memcpy(index, courses, sizeof(Course) * coursesAmount);
+    qsort(index, coursesAmount, sizeof(Course), compareCourses);
+
     *coursesSize = coursesAmount;
+    *courseIndex = index;
     return courses;
 }
 
@@ -359,8 +924,13 @@ Hacker createHacker(Student student, int courses, int friends, int rivals) {
     out->m_courses = (Course*)malloc(sizeof(Course) * courses);
     out->m_friends = (Student*)malloc(sizeof(Student) * friends);
     out->m_rivals = (Student*)malloc(sizeof(Student) * rivals);
+    out->m_friendIndices = (int*)malloc(sizeof(int) * MAX(friends, 1));
+    out->m_rivalIndices = (int*)malloc(sizeof(int) * MAX(rivals, 1));
+    out->m_friendIndicesSize = 0;
+    out->m_rivalIndicesSize = 0;
 
-    if (!out->m_courses || !out->m_friends || !out->m_rivals) {
+    if (!out->m_courses || !out->m_friends || !out->m_rivals ||
+        !out->m_friendIndices || !out->m_rivalIndices) {
         destroyHacker(out);
         out = NULL;
     }
@@ -368,11 +938,32 @@ Hacker createHacker(Student student, int courses, int friends, int rivals) {
     return out;
 }
 
-Hacker parseHacker(EnrollmentSystem sys, char* IDBuffer, char* coursesBuffer,
-                   char* friendsBuffer, char* rivalsBuffer)
+int compareInts(const void* a, const void* b)
+{
+    int first = *(const int*)a;
+    int second = *(const int*)b;
+    return (first > second) - (first < second);
+}
+
+// Fills indices with the sorted indices of the given students, skipping the
+// ones that weren't found. Returns the number of indices.
+int sortStudentIndices(Student* students, int size, int* indices)
+{
+    int indicesSize = 0;
+    for (int i = 0; i < size; i++) {
+        if (students[i]) {
+            indices[indicesSize++] = students[i]->m_index;
+        }
+    }
+
+    qsort(indices, indicesSize, sizeof(int), compareInts);
+    return indicesSize;
+}
+
+Hacker parseHacker(EnrollmentSystem sys, StringView IDLine, StringView coursesLine,
+                   StringView friendsLine, StringView rivalsLine)
 {
     Hacker hacker = NULL;
-    char* tempCourseBuffer = (char*)calloc(strlen(coursesBuffer) + 1, sizeof(char));
     char tempIDBuffer[ID_SIZE + 1] = { 0 };
     Student student = NULL;
     int courses = 0;
@@ -380,76 +971,81 @@ Hacker parseHacker(EnrollmentSystem sys, char* IDBuffer, char* coursesBuffer,
     int rivals = 0;
     int i = 0;
 
-    sscanf(IDBuffer, "%s", tempIDBuffer);
+    nextID(&IDLine, tempIDBuffer);
     student = getStudentFromID(sys, tempIDBuffer);
 
-    courses = countElementsInLine(coursesBuffer);
-    friends = countElementsInLine(friendsBuffer);
-    rivals = countElementsInLine(rivalsBuffer);
+    courses = countElementsInLine(coursesLine);
+    friends = countElementsInLine(friendsLine);
+    rivals = countElementsInLine(rivalsLine);
 
     hacker = createHacker(student, courses, friends, rivals);
     if (!hacker) {
-        free(tempCourseBuffer);
         return NULL;
     }
 
-    char* current = coursesBuffer;
     for(i = 0; i < courses; i++) {
-        char* space = strchr(current, ' ');
+        // Like atoi, a course number that can't be read is 0.
+        StringView number = coursesLine;
+        int courseNum = 0;
+        const char* space = memchr(coursesLine.m_data, ' ', coursesLine.m_length);
         if (space) {
-            *space = '\0';
+            number.m_length = space - coursesLine.m_data;
+            skipChars(&coursesLine, number.m_length + 1);
         }
-        strcpy(tempCourseBuffer, current);
-        hacker->m_courses[i] = getCourseFromNum(sys, atoi(tempCourseBuffer));
-        current = space + 1;
+        nextInt(&number, &courseNum);
+        hacker->m_courses[i] = getCourseFromNum(sys, courseNum);
     }
 
     for(i = 0; i < friends; i++) {
-        memcpy(tempIDBuffer, friendsBuffer + i * (ID_SIZE + 1), ID_SIZE);
+        copyIDAt(friendsLine, i * (ID_SIZE + 1), tempIDBuffer);
         hacker->m_friends[i] = getStudentFromID(sys, tempIDBuffer);
     }
 
     for(i = 0; i < rivals; i++) {
-        memcpy(tempIDBuffer, rivalsBuffer + i * (ID_SIZE + 1), ID_SIZE);
+        copyIDAt(rivalsLine, i * (ID_SIZE + 1), tempIDBuffer);
         hacker->m_rivals[i] = getStudentFromID(sys, tempIDBuffer);
     }
 
-    free(tempCourseBuffer);
+    hacker->m_friendIndicesSize = sortStudentIndices(
+        hacker->m_friends, friends, hacker->m_friendIndices
+    );
+    hacker->m_rivalIndicesSize = sortStudentIndices(
+        hacker->m_rivals, rivals, hacker->m_rivalIndices
+    );
+
     return hacker;
 }
 
 //parses the hackers file and saves the information
-Hacker* parseHackersFile(EnrollmentSystem sys, FILE* hackersFile, int* hackersSize)
+Hacker* parseHackersFile(EnrollmentSystem sys, LineReader* reader, int* hackersSize)
 {
+    StringView lines[4];
+    int hackersAmount = 0;
+    int capacity = 0;
     bool error = false;
-    char* IDBuffer = NULL;
-    char* coursesBuffer = NULL;
-    char* friendsBuffer = NULL;
-    char* rivalsBuffer = NULL;
-
-    int hackersAmount = getLineNum(hackersFile) / 4;
-    Hacker* hackers = (Hacker*)malloc(sizeof(Hacker) * hackersAmount);
-    if(!hackers) {
-        return NULL;
-    }
-
-    for(int i = 0; i < hackersAmount; i++) {
-        IDBuffer = readLine(hackersFile);
-        coursesBuffer = readLine(hackersFile);
-        friendsBuffer = readLine(hackersFile);
-        rivalsBuffer = readLine(hackersFile);
+    Hacker* hackers = NULL;
 
-        hackers[i] = parseHacker(sys, IDBuffer, coursesBuffer, friendsBuffer, rivalsBuffer);
-        error = !hackers[i] ? true : error;
-
-        free(IDBuffer);
-        free(coursesBuffer);
-        free(friendsBuffer);
-        free(rivalsBuffer);
+    // Every hacker takes four lines, and the lines left after the last one are
+    // ignored.
+    while (readLines(reader, lines, 4)) {
+        if (!growArray((void**)&hackers, hackersAmount, &capacity, sizeof(Hacker))) {
+            error = true;
+            break;
+        }
+        hackers[hackersAmount] = parseHacker(sys, lines[0], lines[1], lines[2], lines[3]);
+        if (!hackers[hackersAmount]) {
+            error = true;
+            break;
+        }
+        hackersAmount++;
     }
 
-    if (error) {
+    if (!hackers && !error) {
+        hackers = (Hacker*)malloc(sizeof(Hacker));
+    }
+    if (error || reader->m_failed || !hackers) {
         destroyHackersArray(hackers, hackersAmount);
+        free(hackers);
         return NULL;
     }
 
@@ -457,32 +1053,37 @@ Hacker* parseHackersFile(EnrollmentSystem sys, FILE* hackersFile, int* hackersSi
     return hackers;
 }
 
-//check if a hacker is friends with a given student
-bool checkFriend(Hacker hacker, Student student)
+//binary searches sorted indices for a student's index
+bool containsStudentIndex(const int* indices, int size, Student student)
 {
-    for(int i = 0; i < hacker->m_friendsSize; i++)
+    int low = 0;
+    int high = size;
+    while(low < high)
     {
-        if(hacker->m_friends[i] == student)
+        int middle = low + (high - low) / 2;
+        if(indices[middle] < student->m_index)
         {
-            return true;
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
         }
     }
 
-    return false;
+    return low < size && indices[low] == student->m_index;
+}
+
+//check if a hacker is friends with a given student
+bool checkFriend(Hacker hacker, Student student)
+{
+    return containsStudentIndex(hacker->m_friendIndices, hacker->m_friendIndicesSize, student);
 }
 
 //check if a hacker is a rival with a given student
 bool checkRival(Hacker hacker, Student student)
 {
-    for(int i = 0; i < hacker->m_rivalsSize; i++)
-    {
-        if(hacker->m_rivals[i] == student)
-        {
-            return true;
-        }
-    }
-
-    return false;
+    return containsStudentIndex(hacker->m_rivalIndices, hacker->m_rivalIndicesSize, student);
 }
 
 //friendship functions
@@ -519,9 +1120,9 @@ int friendshipFunction1(void* person1, void* person2)
     return friendship;
 }
 
-int stringDiff(const char* str1, const char* str2, bool caseSensitive) {
-    int len1 = strlen(str1);
-    int len2 = strlen(str2);
+int stringDiff(StringView str1, StringView str2, bool caseSensitive) {
+    int len1 = str1.m_length;
+    int len2 = str2.m_length;
     int len = MAX(len1, len2);
     int sum = 0;
 
@@ -529,17 +1130,17 @@ int stringDiff(const char* str1, const char* str2, bool caseSensitive) {
     {
         if(i >= len1)
         {
-            sum += lowerCaseConditional(str2[i], !caseSensitive);
+            sum += lowerCaseConditional(str2.m_data[i], !caseSensitive);
         }
         else if(i >= len2)
         {
-            sum += lowerCaseConditional(str1[i], !caseSensitive);
+            sum += lowerCaseConditional(str1.m_data[i], !caseSensitive);
         }
         else
         {
             sum += abs(
-                lowerCaseConditional(str1[i], !caseSensitive)
-                - lowerCaseConditional(str2[i], !caseSensitive)
+                lowerCaseConditional(str1.m_data[i], !caseSensitive)
+                - lowerCaseConditional(str2.m_data[i], !caseSensitive)
             );
         }
     }
@@ -554,6 +1155,20 @@ int friendshipFunction2(void* person1, void* person2, bool caseSensitive)
 
     int nameDiff = 0;
 
+    if (namesDiffKernel && person1Student->m_hasPaddedNames && person2Student->m_hasPaddedNames) {
+        return namesDiffKernel(person1Student->m_paddedNames, person2Student->m_paddedNames);
+    }
+
+    // Folding is done by setCaseSensitive, unless it ran out of memory.
+    if (!caseSensitive && person1Student->m_foldedName.m_data &&
+        person2Student->m_foldedName.m_data) {
+        nameDiff += stringDiff(person1Student->m_foldedName, person2Student->m_foldedName, true);
+        nameDiff += stringDiff(
+            person1Student->m_foldedSurname, person2Student->m_foldedSurname, true
+        );
+        return nameDiff;
+    }
+
     nameDiff += stringDiff(person1Student->m_name, person2Student->m_name, caseSensitive);
     nameDiff += stringDiff(person1Student->m_surname, person2Student->m_surname, caseSensitive);
 
@@ -573,29 +1188,46 @@ int friendshipFunction3(void* person1, void* person2)
     Student person1Student = (Student)person1;
     Student person2Student = (Student)person2;
 
-    return abs(atoi(person1Student->m_ID) - atoi(person2Student->m_ID));
+    return abs(person1Student->m_numericID - person2Student->m_numericID);
 }
 
-bool isInCourse(Student student, Course course)
+// Decides what the three friendship functions decide together, in the order
+// they are added to the queues, without a call through a pointer for each.
+int scoreStudents(void* person1, void* person2, int friendshipThreshold, int rivalryThreshold,
+                  bool caseSensitive)
 {
-    IsraeliQueue queue = IsraeliQueueClone(course->m_queue);
-    int studentsNum = course->m_size;
-    while(queue && studentsNum > 0)
-    {
-        if(strcmp(((Student)IsraeliQueueDequeue(queue))->m_ID, student->m_ID) == 0)
-        {
-            IsraeliQueueDestroy(queue);
-            return true;
-        }
-        studentsNum--;
+    int friendship = friendshipFunction1(person1, person2);
+    if (friendship > friendshipThreshold) {
+        return 1;
+    }
+    friendship += friendshipFunction2(person1, person2, caseSensitive);
+    if (friendship > friendshipThreshold) {
+        return 1;
     }
+    friendship += friendshipFunction3(person1, person2);
+    if (friendship > friendshipThreshold) {
+        return 1;
+    }
+
+    return ((float)friendship) / STUDENT_MEASURES < rivalryThreshold ? -1 : 0;
+}
 
-    IsraeliQueueDestroy(queue);
-    return false;
+int scoreStudentsSensitive(void* person1, void* person2, int friendshipThreshold, int rivalryThreshold) {
+    return scoreStudents(person1, person2, friendshipThreshold, rivalryThreshold, true);
+}
+int scoreStudentsInsensitive(void* person1, void* person2, int friendshipThreshold, int rivalryThreshold) {
+    return scoreStudents(person1, person2, friendshipThreshold, rivalryThreshold, false);
+}
+
+bool isInCourse(Student student, Course course)
+{
+    return IsraeliQueueIsWithinFirst(course->m_queue, student, course->m_size);
 }
 
 //header implementations
-EnrollmentSystem createEnrollment(FILE* students, FILE* courses, FILE* hackers)
+// Creates an enrollment system out of readers of its files.
+EnrollmentSystem createEnrollmentFromReaders(LineReader* students, LineReader* courses,
+                                             LineReader* hackers)
 {
     EnrollmentSystem sys = (EnrollmentSystem)malloc(sizeof(struct EnrollmentSystem_t));
     int size = 0;
@@ -605,18 +1237,58 @@ EnrollmentSystem createEnrollment(FILE* students, FILE* courses, FILE* hackers)
         return NULL;
     }
 
-    sys->m_students = parseStudentsFile(students, &size);
+    sys->m_queueBackend = ISRAELIQUEUE_LINKED_LIST;
+    sys->m_jobs = 1;
+    sys->m_studentsMap = NULL;
+    sys->m_studentsMapSize = 0;
+    sys->caseSensitive = true;
+    sys->m_fusedScoring = true;
+    sys->m_measureOrder = ISRAELIQUEUE_ORDER_REGISTRATION;
+    sys->m_namesFolded = false;
+    pthread_once(&namesDiffKernelSelected, selectNamesDiffKernel);
+
+    // All course queues, and their clones, share one node pool.
+    sys->m_nodePool = IsraeliQueueNodePoolCreate();
+    if (!sys->m_nodePool)
+    {
+        free(sys);
+        return NULL;
+    }
+
+    // Text read from a mapped file is left in it.
+    sys->m_textArena = NULL;
+    if (students->m_file && !(sys->m_textArena = createTextArena()))
+    {
+        IsraeliQueueNodePoolDestroy(sys->m_nodePool);
+        free(sys);
+        return NULL;
+    }
+
+    sys->m_students = parseStudentsFile(students, sys->m_textArena, &size);
     sys->m_studentsSize = size;
-    sys->m_courses = parseCoursesFile(courses, &size);
+    sys->m_studentIndex = NULL;
+    sys->m_studentIndexCapacity = 0;
+    if(sys->m_students)
+    {
+        // Hackers and queues look students up by id, so index them first.
+        sys->m_studentIndex = createStudentIndex(sys->m_students, sys->m_studentsSize,
+                                                 &sys->m_studentIndexCapacity);
+    }
+    sys->m_courseIndex = NULL;
+    sys->m_courses = parseCoursesFile(courses, sys->m_nodePool, &size, &sys->m_courseIndex);
     sys->m_coursesSize = size;
     sys->m_hackers = parseHackersFile(sys, hackers, &size);
     sys->m_hackersSize = size;
 
-    if(!sys->m_students || !sys->m_courses || !sys->m_hackers)
+    if(!sys->m_students || !sys->m_studentIndex || !sys->m_courses || !sys->m_hackers)
     {
+        free(sys->m_studentIndex);
         free(sys->m_students);
         free(sys->m_courses);
+        free(sys->m_courseIndex);
         free(sys->m_hackers);
+        IsraeliQueueNodePoolDestroy(sys->m_nodePool);
+        destroyTextArena(sys->m_textArena);
         free(sys);
         return NULL;
     }
@@ -624,126 +1296,438 @@ EnrollmentSystem createEnrollment(FILE* students, FILE* courses, FILE* hackers)
     return sys;
 }
 
+EnrollmentSystem createEnrollment(FILE* students, FILE* courses, FILE* hackers)
+{
+    LineReader readers[3];
+    EnrollmentSystem sys = NULL;
+
+    initLineReader(&readers[0], students);
+    initLineReader(&readers[1], courses);
+    initLineReader(&readers[2], hackers);
+    sys = createEnrollmentFromReaders(&readers[0], &readers[1], &readers[2]);
+    for (int i = 0; i < 3; i++) {
+        destroyLineReader(&readers[i]);
+    }
+
+    return sys;
+}
+
+EnrollmentSystem createEnrollmentMapped(FILE* students, FILE* courses, FILE* hackers)
+{
+    FILE* files[3] = { students, courses, hackers };
+    char* maps[3] = { NULL };
+    size_t sizes[3] = { 0 };
+    LineReader readers[3];
+    EnrollmentSystem sys = NULL;
+
+    for (int i = 0; i < 3; i++) {
+        maps[i] = mapFile(files[i], &sizes[i]);
+        if (maps[i]) {
+            initMappedLineReader(&readers[i], maps[i], sizes[i]);
+        } else {
+            initLineReader(&readers[i], files[i]);
+        }
+    }
+
+    sys = createEnrollmentFromReaders(&readers[0], &readers[1], &readers[2]);
+
+    // The students' text points into their mapped file, so it lives as long as they do.
+    if (sys) {
+        sys->m_studentsMap = maps[0];
+        sys->m_studentsMapSize = sizes[0];
+    } else {
+        unmapFile(maps[0], sizes[0]);
+    }
+    for (int i = 0; i < 3; i++) {
+        destroyLineReader(&readers[i]);
+    }
+    unmapFile(maps[1], sizes[1]);
+    unmapFile(maps[2], sizes[2]);
+
+    return sys;
+}
+
 EnrollmentSystem readEnrollment(EnrollmentSystem sys, FILE* queues)
 {
-    char* line = NULL;
-    char* lineAfterCourse = NULL;
+    LineReader reader;
+    StringView line;
+    StringView cursor;
+    StringView lineAfterCourse;
     char IDBuffer[ID_SIZE + 1] = { 0 };
     int courseNum = 0;
     int elements = 0;
     Course course = { 0 };
+    void** lineStudents = NULL;
+    void** lineStudentsNew = NULL;
+    int lineStudentsCapacity = 0;
 
-    while((line = readLine(queues)))
+    initLineReader(&reader, queues);
+    while(readLines(&reader, &line, 1))
     {
-        sscanf(line, "%d", &courseNum);
+        // Like sscanf, a line without a course number keeps the previous one.
+        cursor = line;
+        nextInt(&cursor, &courseNum);
         course = getCourseFromNum(sys, courseNum);
         elements = countElementsInLine(line);
-        lineAfterCourse = strchr(line, ' ') + 1;
-        for(int j = 0; j < elements - 1; j++)
-        {
-            memcpy(IDBuffer, lineAfterCourse + j * (ID_SIZE + 1), ID_SIZE);
-            if (IsraeliQueueEnqueue(course->m_queue, getStudentFromID(sys, IDBuffer)) != ISRAELIQUEUE_SUCCESS) {
+
+        // Gather the line's students, and enqueue them all at once.
+        if (elements - 1 > lineStudentsCapacity) {
+            lineStudentsCapacity = MAX(elements - 1, lineStudentsCapacity * 2);
+            lineStudentsNew = realloc(lineStudents, sizeof(void*) * lineStudentsCapacity);
+            if (lineStudentsNew == NULL) {
+                free(lineStudents);
+                destroyLineReader(&reader);
                 return NULL;
             }
+            lineStudents = lineStudentsNew;
+        }
+        if (elements > 1) {
+            // There's more than one element, so there's a space after the course number.
+            lineAfterCourse = line;
+            skipChars(&lineAfterCourse,
+                      (const char*)memchr(line.m_data, ' ', line.m_length) - line.m_data + 1);
+        }
+        for(int j = 0; j < elements - 1; j++)
+        {
+            copyIDAt(lineAfterCourse, j * (ID_SIZE + 1), IDBuffer);
+            lineStudents[j] = getStudentFromID(sys, IDBuffer);
+        }
+        if (elements > 1 &&
+            IsraeliQueueEnqueueMany(course->m_queue, lineStudents, elements - 1) != ISRAELIQUEUE_SUCCESS) {
+            free(lineStudents);
+            destroyLineReader(&reader);
+            return NULL;
         }
-
-        free(line);
     }
 
+    free(lineStudents);
+    if (reader.m_failed) {
+        destroyLineReader(&reader);
+        return NULL;
+    }
+    destroyLineReader(&reader);
     return sys;
 }
 
-bool enqueueHackers(EnrollmentSystem sys) {
-    Hacker hacker = NULL;
-    Course course = NULL;
+// The hackers of every course, in the order they are enqueued to it. Entry e
+// is a hacker's request for one of its courses, and the requests of course c
+// are entries m_courseStart[c] to m_courseStart[c + 1] - 1 of m_students and
+// m_requests. m_admitted holds the result of each request, numbered in the
+// order of the hackers and their courses.
+typedef struct CourseTasks {
+    EnrollmentSystem m_sys;
+    int* m_courseStart;
+    void** m_students;
+    int* m_requests;
+    bool* m_admitted;
+    int m_nextCourse;
+    bool m_failed;
+    int m_namesDiffLowerBound;
+    pthread_mutex_t m_lock;
+} CourseTasks;
+
+void destroyCourseTasks(CourseTasks* tasks) {
+    free(tasks->m_courseStart);
+    free(tasks->m_students);
+    free(tasks->m_requests);
+    free(tasks->m_admitted);
+}
 
-    // Insert the hackers into the queue.
-    for(int i = 0; i < sys->m_hackersSize; i++)
-    {
-        hacker = sys->m_hackers[i];
-        for(int j = 0; j < hacker->m_coursesSize; j++)
-        {
-            course = hacker->m_courses[j];
-            if (ISRAELIQUEUE_SUCCESS != IsraeliQueueEnqueue(course->m_queue, hacker->m_student)) {
-                return false;
-            }
+// The least friendshipFunction2 can return. Characters past the end of the
+// shorter name are added as they are, and only negative (non-ASCII) ones can
+// make the sum negative, so no pair goes below twice the most negative sum of
+// one student's negative characters. Case folding keeps those as they are.
+int namesDiffLowerBound(EnrollmentSystem sys) {
+    long long least = 0;
+    for(int i = 0; i < sys->m_studentsSize; i++) {
+        Student student = sys->m_students[i];
+        long long negative = 0;
+        for(int j = 0; j < student->m_name.m_length; j++) {
+            negative += MIN(student->m_name.m_data[j], 0);
+        }
+        for(int j = 0; j < student->m_surname.m_length; j++) {
+            negative += MIN(student->m_surname.m_data[j], 0);
+        }
+        least = MIN(least, negative);
+    }
+
+    return (int)MAX(2 * least, (long long)INT_MIN);
+}
+
+// Groups the hackers' requests by course.
+bool createCourseTasks(EnrollmentSystem sys, CourseTasks* tasks) {
+    int requests = 0;
+    for(int i = 0; i < sys->m_hackersSize; i++) {
+        requests += sys->m_hackers[i]->m_coursesSize;
+    }
+
+    tasks->m_sys = sys;
+    tasks->m_courseStart = (int*)calloc(sys->m_coursesSize + 1, sizeof(int));
+    tasks->m_students = (void**)malloc(sizeof(void*) * MAX(requests, 1));
+    tasks->m_requests = (int*)malloc(sizeof(int) * MAX(requests, 1));
+    tasks->m_admitted = (bool*)malloc(sizeof(bool) * MAX(requests, 1));
+    tasks->m_nextCourse = 0;
+    tasks->m_failed = false;
+    tasks->m_namesDiffLowerBound = sys->m_measureOrder != ISRAELIQUEUE_ORDER_REGISTRATION
+        ? namesDiffLowerBound(sys) : 0;
+    if (!tasks->m_courseStart || !tasks->m_students || !tasks->m_requests || !tasks->m_admitted) {
+        destroyCourseTasks(tasks);
+        return false;
+    }
+
+    // Count the requests of each course, then place each one after those of
+    // the previous courses.
+    for(int i = 0; i < sys->m_hackersSize; i++) {
+        for(int j = 0; j < sys->m_hackers[i]->m_coursesSize; j++) {
+            tasks->m_courseStart[sys->m_hackers[i]->m_courses[j]->m_index + 1]++;
         }
     }
+    for(int c = 0; c < sys->m_coursesSize; c++) {
+        tasks->m_courseStart[c + 1] += tasks->m_courseStart[c];
+    }
+
+    int request = 0;
+    for(int i = 0; i < sys->m_hackersSize; i++) {
+        for(int j = 0; j < sys->m_hackers[i]->m_coursesSize; j++) {
+            int index = sys->m_hackers[i]->m_courses[j]->m_index;
+            // Each course's start serves as its cursor, ending up at the start
+            // of the next course. They are shifted back below.
+            int entry = tasks->m_courseStart[index]++;
+            tasks->m_students[entry] = sys->m_hackers[i]->m_student;
+            tasks->m_requests[entry] = request++;
+        }
+    }
+    for(int c = sys->m_coursesSize; c > 0; c--) {
+        tasks->m_courseStart[c] = tasks->m_courseStart[c - 1];
+    }
+    tasks->m_courseStart[0] = 0;
 
     return true;
 }
 
-void printSuccess(EnrollmentSystem sys, FILE* out) {
-    Student student = NULL;
-    IsraeliQueue tempQueue = { 0 };
+// Adds the friendship measures to a course's queue, enqueues its hackers and
+// checks which of them made it in.
+bool runCourseTask(CourseTasks* tasks, int index) {
+    EnrollmentSystem sys = tasks->m_sys;
+    Course course = sys->m_courses[index];
+    IsraeliQueueError error = ISRAELIQUEUE_SUCCESS;
+    int first = tasks->m_courseStart[index];
+    int last = tasks->m_courseStart[index + 1];
+
+    FriendshipFunction measures[STUDENT_MEASURES] = {
+        friendshipFunction1,
+        sys->caseSensitive ? friendshipFunction2Sensitive : friendshipFunction2Insensitive,
+        friendshipFunction3
+    };
+    int lowerBounds[STUDENT_MEASURES] = { -20, tasks->m_namesDiffLowerBound, 0 };
+
+    for (int i = 0; i < STUDENT_MEASURES; i++) {
+        error = !error ? IsraeliQueueAddFriendshipMeasure(course->m_queue, measures[i]) : error;
+    }
+    if (sys->m_measureOrder != ISRAELIQUEUE_ORDER_REGISTRATION) {
+        // The measures are called one by one in the chosen order, instead of
+        // by the fused scorer.
+        for (int i = 0; i < STUDENT_MEASURES; i++) {
+            error = !error ? IsraeliQueueSetMeasureLowerBound(course->m_queue, measures[i], lowerBounds[i]) : error;
+        }
+        error = !error ? IsraeliQueueSetMeasureOrder(course->m_queue, sys->m_measureOrder) : error;
+    }
+    else if (sys->m_fusedScoring) {
+        error = !error ? IsraeliQueueSetFriendshipScorer(
+            course->m_queue,
+            sys->caseSensitive ? scoreStudentsSensitive : scoreStudentsInsensitive
+        ) : error;
+    }
+    error = !error ? IsraeliQueueEnqueueMany(course->m_queue, &tasks->m_students[first], last - first) : error;
+    if (error) {
+        return false;
+    }
 
-    for(int i = 0; i < sys->m_coursesSize; i++)
-    {
-        // Clone the queue and get the first student.
-        tempQueue = IsraeliQueueClone(sys->m_courses[i]->m_queue);
-        student = IsraeliQueueDequeue(tempQueue);
+    for(int entry = first; entry < last; entry++) {
+        tasks->m_admitted[tasks->m_requests[entry]] = isInCourse(tasks->m_students[entry], course);
+    }
 
-        // Only continue if there are students in the queue.
-        if (!student) {
-            IsraeliQueueDestroy(tempQueue);
-            continue;
+    return true;
+}
+
+// Runs course tasks until there are none left.
+void* courseWorker(void* arg) {
+    CourseTasks* tasks = (CourseTasks*)arg;
+
+    while (true) {
+        pthread_mutex_lock(&tasks->m_lock);
+        int index = tasks->m_nextCourse++;
+        pthread_mutex_unlock(&tasks->m_lock);
+
+        if (index >= tasks->m_sys->m_coursesSize) {
+            return NULL;
         }
 
-        fprintf(out, "%d", sys->m_courses[i]->m_number);
-        while(student)
-        {
-            fprintf(out, " %s", student->m_ID);
-            student = IsraeliQueueDequeue(tempQueue);
+        if (!runCourseTask(tasks, index)) {
+            pthread_mutex_lock(&tasks->m_lock);
+            tasks->m_failed = true;
+            pthread_mutex_unlock(&tasks->m_lock);
         }
-        fprintf(out, "\n");
+    }
+}
+
+// Runs all the course tasks on the system's number of threads, including the
+// calling one. Returns false if any of them failed.
+bool runCourseTasks(CourseTasks* tasks) {
+    int jobs = MAX(1, tasks->m_sys->m_jobs);
+    pthread_t* threads = NULL;
+    int threadsStarted = 0;
+
+    if (pthread_mutex_init(&tasks->m_lock, NULL) != 0) {
+        return false;
+    }
 
-        IsraeliQueueDestroy(tempQueue);
+    // If threads can't be created, the calling thread does all the work.
+    if (jobs > 1) {
+        threads = (pthread_t*)malloc(sizeof(pthread_t) * (jobs - 1));
     }
+    while (threads && threadsStarted < jobs - 1 &&
+           pthread_create(&threads[threadsStarted], NULL, courseWorker, tasks) == 0) {
+        threadsStarted++;
+    }
+
+    courseWorker(tasks);
+
+    for(int i = 0; i < threadsStarted; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+    pthread_mutex_destroy(&tasks->m_lock);
+
+    return !tasks->m_failed;
 }
 
-void hackEnrollment(EnrollmentSystem sys, FILE* out)
-{
-    IsraeliQueueError error = ISRAELIQUEUE_SUCCESS;
+// Collects output in a buffer that is written to the file in large blocks.
+typedef struct OutputWriter {
+    FILE* m_file;
+    size_t m_length;
+    char m_buffer[OUTPUT_WRITER_BLOCK];
+} OutputWriter;
 
-    for(int i = 0; i < sys->m_coursesSize; i++) {
-        error = !error ? IsraeliQueueAddFriendshipMeasure(sys->m_courses[i]->m_queue, friendshipFunction1) : error;
-        error = !error ? IsraeliQueueAddFriendshipMeasure(
-            sys->m_courses[i]->m_queue,
-            sys->caseSensitive ? friendshipFunction2Sensitive : friendshipFunction2Insensitive
-        ) : error;
-        error = !error ? IsraeliQueueAddFriendshipMeasure(sys->m_courses[i]->m_queue, friendshipFunction3) : error;
+void initOutputWriter(OutputWriter* writer, FILE* file) {
+    writer->m_file = file;
+    writer->m_length = 0;
+}
 
-        if (error) {
-            return;
+void flushOutputWriter(OutputWriter* writer) {
+    if (writer->m_length > 0) {
+        fwrite(writer->m_buffer, 1, writer->m_length, writer->m_file);
+    }
+    writer->m_length = 0;
+}
+
+// Returns room in the buffer for the given number of bytes, which must not be
+// more than its size, flushing it first if needed.
+char* reserveOutput(OutputWriter* writer, size_t size) {
+    if (OUTPUT_WRITER_BLOCK - writer->m_length < size) {
+        flushOutputWriter(writer);
+    }
+    return writer->m_buffer + writer->m_length;
+}
+
+void writeOutputChar(OutputWriter* writer, char character) {
+    *reserveOutput(writer, 1) = character;
+    writer->m_length++;
+}
+
+void writeOutputText(OutputWriter* writer, const char* text, size_t length) {
+    memcpy(reserveOutput(writer, length), text, length);
+    writer->m_length += length;
+}
+
+// Writes a number like "%d" does.
+void writeOutputInt(OutputWriter* writer, int number) {
+    char digits[sizeof(int) * 3 + 1];
+    int start = sizeof(digits);
+    unsigned int magnitude = number < 0 ? 0u - (unsigned int)number : (unsigned int)number;
+
+    do {
+        digits[--start] = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude > 0);
+    if (number < 0) {
+        digits[--start] = '-';
+    }
+
+    writeOutputText(writer, digits + start, sizeof(digits) - start);
+}
+
+// Writes a student of a course's queue, after a space. Stops at an ID that
+// matched no student, which is queued as NULL.
+bool writeQueuedStudent(void* student, void* writer) {
+    if (!student) {
+        return false;
+    }
+
+    const char* ID = ((Student)student)->m_ID;
+    writeOutputChar((OutputWriter*)writer, ' ');
+    writeOutputText((OutputWriter*)writer, ID, strlen(ID));
+    return true;
+}
+
+void printSuccess(EnrollmentSystem sys, FILE* out) {
+    OutputWriter writer;
+    initOutputWriter(&writer, out);
+
+    for(int i = 0; i < sys->m_coursesSize; i++)
+    {
+        // Only courses with students in their queues are printed.
+        if (!IsraeliQueuePeekAt(sys->m_courses[i]->m_queue, 0)) {
+            continue;
         }
+
+        writeOutputInt(&writer, sys->m_courses[i]->m_number);
+        IsraeliQueueForEach(sys->m_courses[i]->m_queue, writeQueuedStudent, &writer);
+        writeOutputChar(&writer, '\n');
     }
 
-    if (!enqueueHackers(sys)) {
+    flushOutputWriter(&writer);
+}
+
+void hackEnrollment(EnrollmentSystem sys, FILE* out)
+{
+    CourseTasks tasks;
+
+    // The courses are independent, so they are processed first, possibly in
+    // parallel, and the results are then checked in the order of the hackers.
+    if (!createCourseTasks(sys, &tasks)) {
+        return;
+    }
+    if (!runCourseTasks(&tasks)) {
+        destroyCourseTasks(&tasks);
         return;
     }
 
     int coursesDeclined = 0;
+    int request = 0;
     bool success = true;
     for(int i = 0; i < sys->m_hackersSize; i++) {
         if(sys->m_hackers[i]->m_coursesSize == 1) {
-            success = isInCourse(sys->m_hackers[i]->m_student, sys->m_hackers[i]->m_courses[0]) ? success : false;
+            success = tasks.m_admitted[request] ? success : false;
         }
         else {
             for(int j = 0; j < sys->m_hackers[i]->m_coursesSize; j++) {
-                coursesDeclined = isInCourse(sys->m_hackers[i]->m_student, sys->m_hackers[i]->m_courses[j]) ?
-                    coursesDeclined : coursesDeclined + 1;
+                coursesDeclined = tasks.m_admitted[request + j] ? coursesDeclined : coursesDeclined + 1;
             }
 
             success = coursesDeclined < 2;
         }
-        
+        request += sys->m_hackers[i]->m_coursesSize;
+
         if(!success) {
             fprintf(out, "Cannot satisfy constraints for %s\n", sys->m_hackers[i]->m_student->m_ID);
+            destroyCourseTasks(&tasks);
             return;
         }
         coursesDeclined = 0;
     }
 
+    destroyCourseTasks(&tasks);
     printSuccess(sys, out);
 }
 
@@ -760,19 +1744,118 @@ void destroyEnrollment(EnrollmentSystem enrollment) {
         destroyCourse(enrollment->m_courses[i]);
     }
     free(enrollment->m_courses);
+    free(enrollment->m_courseIndex);
     destroyStudentsArray(enrollment->m_students, enrollment->m_studentsSize);
     free(enrollment->m_students);
+    free(enrollment->m_studentIndex);
     destroyHackersArray(enrollment->m_hackers, enrollment->m_hackersSize);
     free(enrollment->m_hackers);
+    IsraeliQueueNodePoolDestroy(enrollment->m_nodePool);
+    unmapFile(enrollment->m_studentsMap, enrollment->m_studentsMapSize);
+    destroyTextArena(enrollment->m_textArena);
 
     // It's good practice to NULL dangling pointers.
     enrollment->m_students = NULL;
+    enrollment->m_studentIndex = NULL;
     enrollment->m_courses = NULL;
+    enrollment->m_courseIndex = NULL;
     enrollment->m_hackers = NULL;
+    enrollment->m_nodePool = NULL;
+    enrollment->m_studentsMap = NULL;
+    enrollment->m_textArena = NULL;
 
     free(enrollment);
 }
 
+// Copies a view to the arena, case folded like lowerCaseChar. Its data is NULL
+// if allocation fails.
+StringView textArenaCopyFolded(TextArena arena, StringView view) {
+    StringView out = textArenaCopy(arena, view);
+    char* data = (char*)out.m_data;
+
+    for (int i = 0; data && i < out.m_length; i++) {
+        data[i] = lowerCaseChar(data[i]);
+    }
+
+    return out;
+}
+
+// Case folds the students' names once, for case insensitive comparisons.
+void foldStudentNames(EnrollmentSystem sys) {
+    // Names in a mapped file are left there, so the folded ones need an arena.
+    if (!sys->m_textArena && !(sys->m_textArena = createTextArena())) {
+        return;
+    }
+
+    for (int i = 0; i < sys->m_studentsSize; i++) {
+        Student student = sys->m_students[i];
+        student->m_foldedName = textArenaCopyFolded(sys->m_textArena, student->m_name);
+        student->m_foldedSurname = textArenaCopyFolded(sys->m_textArena, student->m_surname);
+        if (!student->m_foldedSurname.m_data) {
+            student->m_foldedName.m_data = NULL;
+        }
+    }
+    sys->m_namesFolded = true;
+}
+
 void setCaseSensitive(EnrollmentSystem sys, bool sensitive) {
     sys->caseSensitive = sensitive;
+    if (!sensitive && !sys->m_namesFolded) {
+        foldStudentNames(sys);
+    }
+
+    // The padded names are compared as they are, so they are the folded names
+    // when the system is case insensitive.
+    for (int i = 0; i < sys->m_studentsSize; i++) {
+        Student student = sys->m_students[i];
+        if (sensitive) {
+            padStudentNames(student, student->m_name, student->m_surname);
+        } else if (student->m_foldedName.m_data) {
+            padStudentNames(student, student->m_foldedName, student->m_foldedSurname);
+        } else {
+            student->m_hasPaddedNames = false;
+        }
+    }
+}
+
+// Replaces the empty course queues with ones that follow the system's queue
+// backend and number of jobs.
+bool recreateCourseQueues(EnrollmentSystem sys) {
+    // Threads working on different courses can't share a node pool.
+    IsraeliQueueNodePool pool = sys->m_jobs > 1 ? NULL : sys->m_nodePool;
+
+    for (int i = 0; i < sys->m_coursesSize; i++) {
+        // Only empty queues are replaced, so nothing needs to be moved over.
+        if (IsraeliQueueSize(sys->m_courses[i]->m_queue) > 0) {
+            return false;
+        }
+
+        IsraeliQueue queue = createCourseQueue(pool, sys->m_queueBackend);
+        if (!queue) {
+            return false;
+        }
+
+        IsraeliQueueDestroy(sys->m_courses[i]->m_queue);
+        sys->m_courses[i]->m_queue = queue;
+    }
+
+    return true;
+}
+
+bool setQueueBackend(EnrollmentSystem sys, IsraeliQueueBackend backend) {
+    sys->m_queueBackend = backend;
+    return recreateCourseQueues(sys);
+}
+
+bool setJobs(EnrollmentSystem sys, int jobs) {
+    sys->m_jobs = jobs;
+    return recreateCourseQueues(sys);
+}
+
+void setFusedScoring(EnrollmentSystem sys, bool fused) {
+    sys->m_fusedScoring = fused;
+}
+
+void setMeasureOrder(EnrollmentSystem sys, IsraeliQueueMeasureOrder order) {
+    sys->m_measureOrder = order;
 }
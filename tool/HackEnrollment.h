@@ -10,6 +10,7 @@
 
 
 #define ID_SIZE 9
+#define NAME_PAD_SIZE 16
 #define FRIENDSHIP_THRESHOLD 20
 #define RIVALRY_THRESHOLD 0
 
@@ -17,19 +18,36 @@ typedef struct Student_t * Student;
 typedef struct Course_t * Course;
 typedef struct Hacker_t * Hacker;
 typedef struct EnrollmentSystem_t * EnrollmentSystem;
+typedef struct TextArena_t * TextArena;
+
+//A string that isn't necessarily null terminated, such as a field of a mapped file.
+typedef struct StringView {
+    const char* m_data;
+    int m_length;
+} StringView;
 
 typedef struct Student_t {
+    int m_index;
     char m_ID[ID_SIZE + 1];
+    int m_numericID;
     int m_credits;
     int m_GPA;
-    char* m_name;
-    char* m_surname;
-    char* m_city;
-    char* m_department;
+    StringView m_name;
+    StringView m_surname;
+    StringView m_city;
+    StringView m_department;
+    //Case folded copies of the name and surname, made when the system is set case insensitive.
+    StringView m_foldedName;
+    StringView m_foldedSurname;
+    //The name and surname as compared, so folded if the system is case insensitive, each zero
+    //padded to NAME_PAD_SIZE, for the vectorized stringDiff.
+    unsigned char m_paddedNames[2 * NAME_PAD_SIZE];
+    bool m_hasPaddedNames;
     Hacker m_hacker;
 } Student_t;
 
 typedef struct Course_t {
+    int m_index;
     int m_number;
     int m_size;
     IsraeliQueue m_queue;
@@ -43,21 +61,42 @@ typedef struct Hacker_t {
     int m_friendsSize;
     Student* m_rivals;
     int m_rivalsSize;
+    int* m_friendIndices;
+    int m_friendIndicesSize;
+    int* m_rivalIndices;
+    int m_rivalIndicesSize;
 } Hacker_t;
 
 typedef struct EnrollmentSystem_t {
     Student* m_students;
     int m_studentsSize;
+    Student* m_studentIndex;
+    int m_studentIndexCapacity;
+    char* m_studentsMap;
+    size_t m_studentsMapSize;
+    TextArena m_textArena;
+    bool m_namesFolded;
     Course* m_courses;
+    Course* m_courseIndex;
     int m_coursesSize;
     Hacker* m_hackers;
     int m_hackersSize;
+    IsraeliQueueNodePool m_nodePool;
+    IsraeliQueueBackend m_queueBackend;
+    int m_jobs;
     bool caseSensitive;
+    bool m_fusedScoring;
+    IsraeliQueueMeasureOrder m_measureOrder;
 } EnrollmentSystem_t;
 
 
 EnrollmentSystem createEnrollment(FILE* students, FILE* courses, FILE* hackers);
 
+//Like createEnrollment, but maps the files to memory instead of reading them. The students'
+//text fields point into the mapped students file instead of being copied. Files that can't
+//be mapped are read.
+EnrollmentSystem createEnrollmentMapped(FILE* students, FILE* courses, FILE* hackers);
+
 EnrollmentSystem readEnrollment(EnrollmentSystem sys, FILE* queues);
 
 void hackEnrollment(EnrollmentSystem sys, FILE* out);
@@ -67,5 +106,20 @@ void destroyEnrollment(EnrollmentSystem enrollment);
 
 void setCaseSensitive(EnrollmentSystem system, bool caseSensitive);
 
+//Makes the course queues use the given backend. Must be called before readEnrollment.
+bool setQueueBackend(EnrollmentSystem system, IsraeliQueueBackend backend);
+
+//Makes hackEnrollment process the courses on the given number of threads. Must be called
+//before readEnrollment.
+bool setJobs(EnrollmentSystem system, int jobs);
+
+//Makes the course queues score pairs of students with a single function that computes all
+//the friendship functions, which is the default, or call each of them through the queue.
+void setFusedScoring(EnrollmentSystem system, bool fused);
+
+//Makes the course queues call the friendship functions one by one in the given order, instead
+//of the fused scorer, unless it is ISRAELIQUEUE_ORDER_REGISTRATION, which is the default.
+void setMeasureOrder(EnrollmentSystem system, IsraeliQueueMeasureOrder order);
+
 
 #endif
\ No newline at end of file
@@ -57,30 +57,74 @@ Files openFiles(const char* studentsFileName, const char* coursesFileName,
 
 int main(int argc, const char *argv[]) {
     bool caseSensitive = true;
+    IsraeliQueueBackend backend = ISRAELIQUEUE_LINKED_LIST;
+    int jobs = 1;
+    bool mapped = false;
+    bool fusedScoring = true;
+    IsraeliQueueMeasureOrder measureOrder = ISRAELIQUEUE_ORDER_REGISTRATION;
     const char* commandName = argv[0];
     const char** primaryArgs = &argv[1];
+    int primaryArgsSize = argc - 1;
 
-    if (argc != NUM_REQUIRED_ARGS + 1 && argc != NUM_REQUIRED_ARGS + 2) {
-        printUsageError(commandName);
-        return 0;
-    }
-
-    if (argc == NUM_REQUIRED_ARGS + 2) {
-        if (strcmp(primaryArgs[0], "-i") != 0) {
+    // Move over the flags before the file names.
+    while (primaryArgsSize > NUM_REQUIRED_ARGS) {
+        if (strcmp(primaryArgs[0], "-i") == 0) {
+            caseSensitive = false;
+        } else if (strcmp(primaryArgs[0], "-a") == 0) {
+            backend = ISRAELIQUEUE_ARRAY;
+        } else if (strcmp(primaryArgs[0], "-m") == 0) {
+            mapped = true;
+        } else if (strcmp(primaryArgs[0], "-g") == 0) {
+            fusedScoring = false;
+        } else if (strcmp(primaryArgs[0], "-o") == 0 && primaryArgsSize > NUM_REQUIRED_ARGS + 1) {
+            // Move over the order as well.
+            primaryArgs++;
+            primaryArgsSize--;
+            if (strcmp(primaryArgs[0], "cost") == 0) {
+                measureOrder = ISRAELIQUEUE_ORDER_COST;
+            } else if (strcmp(primaryArgs[0], "decisive") == 0) {
+                measureOrder = ISRAELIQUEUE_ORDER_DECISIVE;
+            } else {
+                printUsageError(commandName);
+                return 0;
+            }
+        } else if (strcmp(primaryArgs[0], "-j") == 0 && primaryArgsSize > NUM_REQUIRED_ARGS + 1) {
+            // Move over the number of jobs as well.
+            primaryArgs++;
+            primaryArgsSize--;
+            jobs = atoi(primaryArgs[0]);
+            if (jobs < 1) {
+                printUsageError(commandName);
+                return 0;
+            }
+        } else {
             printUsageError(commandName);
             return 0;
         }
-        // Move over the -i.
         primaryArgs++;
-        caseSensitive = false;
+        primaryArgsSize--;
+    }
+
+    if (primaryArgsSize != NUM_REQUIRED_ARGS) {
+        printUsageError(commandName);
+        return 0;
     }
 
     Files files = openFiles(
         primaryArgs[0], primaryArgs[1], primaryArgs[2], primaryArgs[3], primaryArgs[4]
     );
     
-    EnrollmentSystem system = createEnrollment(files.students, files.courses, files.hackers);
+    EnrollmentSystem system = mapped
+        ? createEnrollmentMapped(files.students, files.courses, files.hackers)
+        : createEnrollment(files.students, files.courses, files.hackers);
+    if (!system || !setQueueBackend(system, backend) || !setJobs(system, jobs)) {
+        destroyEnrollment(system);
+        closeFiles(files);
+        return 0;
+    }
     setCaseSensitive(system, caseSensitive);
+    setFusedScoring(system, fusedScoring);
+    setMeasureOrder(system, measureOrder);
     readEnrollment(system, files.queues);
     hackEnrollment(system, files.target);
     destroyEnrollment(system);